@@ -143,13 +143,13 @@ void printTopBC(Array<float>& dependencies, unsigned topn = PRINT_TOP) {
     for (auto ii = top.rbegin(), ei = top.rend(); ii != ei; ++ii, ++rank) {
         float value = ii->first.value;
         VID node = ii->first.id;
-        printf("%3d: %20.10f %10u\n", rank, value, node);
+        printf("%3d: %20.10f %10lu\n", rank, value, (uint64_t)node);
     }
 }
 
 int main(int argc, char **argv) {
-    AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    AgileStart(argc, argv, &inIndexFilename);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
 
     // Out graph
     Graph outGraph;
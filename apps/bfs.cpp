@@ -2,6 +2,7 @@
 #include <string>
 #include <queue>
 #include <deque>
+#include <vector>
 #include "llvm/Support/CommandLine.h"
 #include "galois/Galois.h"
 #include "galois/Bag.h"
@@ -44,21 +45,21 @@ static cll::opt<float>
                 cll::init(BINNING_WORKER_RATIO));
 
 
-struct BFS_F : public EDGEMAP_F<uint32_t> {
+struct BFS_F : public EDGEMAP_F<VID> {
     Array<VID>& parents;
 
     BFS_F(Array<VID>& p, Bins* b): parents(p), EDGEMAP_F(b) {}
 
     inline bool cond(VID dst) {
-        return parents[dst] == UINT_MAX;
+        return parents[dst] == VID_NONE;
     }
 
-    inline uint32_t scatter(VID src, VID dst) {
+    inline VID scatter(VID src, VID dst) {
         return src;
     }
 
-    inline bool gather(VID dst, uint32_t val) {
-		if (parents[dst] == UINT_MAX) {
+    inline bool gather(VID dst, VID val) {
+		if (parents[dst] == VID_NONE) {
 			parents[dst] = val;
             return true;
 		}
@@ -72,13 +73,40 @@ struct BFS_Vertex_Init {
     BFS_Vertex_Init(Array<VID>& p): parents(p) {}
 
     inline bool operator() (const VID& node) {
-        parents[node] = UINT_MAX;
+        parents[node] = VID_NONE;
+        return true;
     }
 };
 
+// Levels follow from the parents whichever parent won a race, so a
+// checksum over them is the same for every correct search
+static uint64_t levelChecksum(Array<VID>& parents, uint64_t n, VID start) {
+    constexpr uint32_t LEVEL_NONE = UINT32_MAX;
+    std::vector<uint32_t> levels(n, LEVEL_NONE);
+    std::vector<VID> path;
+    levels[start] = 0;
+
+    uint64_t checksum = 0;
+    for (uint64_t node = 0; node < n; node++) {
+        if (parents[node] == VID_NONE) continue;
+        VID v = node;
+        while (levels[v] == LEVEL_NONE) {
+            path.push_back(v);
+            v = parents[v];
+        }
+        uint32_t level = levels[v];
+        while (!path.empty()) {
+            levels[path.back()] = ++level;
+            path.pop_back();
+        }
+        checksum += (uint64_t)levels[node] * (node + 1);
+    }
+    return checksum;
+}
+
 int main(int argc, char **argv) {
     AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
     runtime.initBinning(binningRatio);
 
     Graph outGraph;
@@ -105,16 +133,27 @@ int main(int argc, char **argv) {
     galois::StatTimer time("Time", "BFS_MAIN");
     time.start();
 
+    long rounds = 0;
     while (!frontier->empty()) {
         Worklist<VID>* output = edgeMap(outGraph, frontier, BFS_F(parents, bins), prop_blocking);
         delete frontier;
         frontier = output;
+        rounds++;
     }
 
     delete frontier;
 
     time.stop();
 
+    galois::GAccumulator<uint64_t> reached;
+    galois::do_all(galois::iterate(outGraph),
+                    [&](const VID& node) {
+                        if (parents[node] != VID_NONE)
+                            reached += 1;
+                    }, galois::no_stats());
+    printf("Reached: %lu, rounds: %ld\n", reached.reduce(), rounds);
+    printf("Level checksum: %lu\n", levelChecksum(parents, n, startNode));
+
     delete bins;
 
     return 0;
@@ -0,0 +1,159 @@
+#include <iostream>
+#include <string>
+#include "llvm/Support/CommandLine.h"
+#include "galois/Galois.h"
+#include "Type.h"
+#include "Graph.h"
+#include "atomics.h"
+#include "Array.h"
+#include "Util.h"
+#include "EdgeMap.h"
+#include "VertexMap.h"
+#include "boilerplate.h"
+#include "Runtime.h"
+
+using namespace blaze;
+namespace cll = llvm::cl;
+
+// Two BFS from different sources whose rounds share one scan of the edges
+
+static cll::opt<unsigned int>
+    startNode("startNode",
+            cll::desc("Node to start the first search from (default value 0)"),
+            cll::init(0));
+
+static cll::opt<unsigned int>
+    startNode2("startNode2",
+            cll::desc("Node to start the second search from (default value 1)"),
+            cll::init(1));
+
+static cll::opt<bool>
+    verify("verify",
+            cll::desc("Run both searches again with separate edgeMaps and compare the levels (default: false)"),
+            cll::init(false));
+
+constexpr static const uint32_t LEVEL_NONE = UINT32_MAX;
+
+struct BFS_F : public EDGEMAP_F<uint32_t> {
+    Array<uint32_t>& levels;
+    uint32_t level;
+
+    BFS_F(Array<uint32_t>& l, uint32_t lv): levels(l), level(lv) {}
+
+    inline bool update(VID src, VID dst) {
+        if (levels[dst] == LEVEL_NONE) {
+            levels[dst] = level;
+            return 1;
+        }
+        else return 0;
+    }
+
+    inline bool updateAtomic(VID src, VID dst) {
+        return compare_and_swap(levels[dst], LEVEL_NONE, level);
+    }
+
+    inline bool cond(VID dst) {
+        return levels[dst] == LEVEL_NONE;
+    }
+};
+
+struct BFS_Vertex_Init {
+    Array<uint32_t>& levels;
+
+    BFS_Vertex_Init(Array<uint32_t>& l): levels(l) {}
+
+    inline bool operator() (const VID& node) {
+        levels[node] = LEVEL_NONE;
+        return 1;
+    }
+};
+
+static Worklist<VID>* startFrontier(Graph& graph, Array<uint32_t>& levels, VID start) {
+    vertexMap(graph, BFS_Vertex_Init(levels));
+    levels[start] = 0;
+    Worklist<VID>* frontier = new Worklist<VID>(graph.NumberOfNodes());
+    frontier->activate(start);
+    return frontier;
+}
+
+static uint64_t countReached(Graph& graph, Array<uint32_t>& levels) {
+    galois::GAccumulator<uint64_t> reached;
+    galois::do_all(galois::iterate(graph),
+                    [&](const VID& node) {
+                        if (levels[node] != LEVEL_NONE)
+                            reached += 1;
+                    }, galois::no_stats());
+    return reached.reduce();
+}
+
+// One BFS with its own edgeMap per round
+static void runAlone(Graph& graph, Array<uint32_t>& levels, VID start) {
+    Worklist<VID>* frontier = startFrontier(graph, levels, start);
+    for (uint32_t level = 1; !frontier->empty(); level++) {
+        Worklist<VID>* output = edgeMap(graph, frontier, BFS_F(levels, level), 0);
+        delete frontier;
+        frontier = output;
+    }
+    delete frontier;
+}
+
+int main(int argc, char **argv) {
+    AgileStart(argc, argv);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
+
+    Graph outGraph;
+    outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
+
+    uint64_t n = outGraph.NumberOfNodes();
+
+    Array<uint32_t> levels1, levels2;
+    levels1.allocate(n);
+    levels2.allocate(n);
+
+    Worklist<VID>* frontier1 = startFrontier(outGraph, levels1, startNode);
+    Worklist<VID>* frontier2 = startFrontier(outGraph, levels2, startNode2);
+
+    galois::StatTimer time("Time", "BFS_SHARED_MAIN");
+    time.start();
+
+    for (uint32_t level = 1; !frontier1->empty() || !frontier2->empty(); level++) {
+        auto outputs = edgeMapShared(outGraph,
+                                     scan(frontier1, BFS_F(levels1, level)),
+                                     scan(frontier2, BFS_F(levels2, level)));
+        delete frontier1;
+        delete frontier2;
+        frontier1 = outputs[0];
+        frontier2 = outputs[1];
+    }
+
+    delete frontier1;
+    delete frontier2;
+
+    time.stop();
+
+    printf("Reached: %lu from %u, %lu from %u\n",
+        countReached(outGraph, levels1), startNode.getValue(),
+        countReached(outGraph, levels2), startNode2.getValue());
+
+    if (verify) {
+        Array<uint32_t> expected;
+        expected.allocate(n);
+        uint64_t mismatches = 0;
+        for (auto pair : { std::make_pair(&levels1, (VID)startNode), std::make_pair(&levels2, (VID)startNode2) }) {
+            runAlone(outGraph, expected, pair.second);
+            Array<uint32_t>& levels = *pair.first;
+            galois::GAccumulator<uint64_t> diff;
+            galois::do_all(galois::iterate(outGraph),
+                            [&](const VID& node) {
+                                if (levels[node] != expected[node])
+                                    diff += 1;
+                            }, galois::no_stats());
+            mismatches += diff.reduce();
+        }
+        printf("Verify: %s (%lu mismatched levels)\n", mismatches ? "FAILED" : "OK", mismatches);
+        if (mismatches)
+            return 1;
+    }
+
+    return 0;
+}
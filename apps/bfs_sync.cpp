@@ -23,13 +23,13 @@ static cll::opt<unsigned int>
             cll::desc("Node to start search from (default value 0)"),
             cll::init(0));
 
-struct BFS_F : public EDGEMAP_F<uint32_t> {
+struct BFS_F : public EDGEMAP_F<VID> {
     Array<VID>& parents;
 
     BFS_F(Array<VID>& p): parents(p) {}
 
     inline bool update(VID src, VID dst) {
-        if (parents[dst] == UINT_MAX) {
+        if (parents[dst] == VID_NONE) {
             parents[dst] = src;
             return 1;
         }
@@ -37,11 +37,11 @@ struct BFS_F : public EDGEMAP_F<uint32_t> {
     }
 
     inline bool updateAtomic(VID src, VID dst) {
-        return compare_and_swap(parents[dst], UINT_MAX, src);
+        return compare_and_swap(parents[dst], VID_NONE, src);
     }
 
     inline bool cond(VID dst) {
-        return parents[dst] == UINT_MAX;
+        return parents[dst] == VID_NONE;
     }
 };
 
@@ -51,13 +51,14 @@ struct BFS_Vertex_Init {
     BFS_Vertex_Init(Array<VID>& p): parents(p) {}
 
     inline bool operator() (const VID& node) {
-        parents[node] = UINT_MAX;
+        parents[node] = VID_NONE;
+        return true;
     }
 };
 
 int main(int argc, char **argv) {
     AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
 
     Graph outGraph;
     outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
@@ -3,6 +3,8 @@
 #include "galois/Galois.h"
 #include "Util.h"
 #include "boilerplate.h"
+#include "Graph.h"
+#include "IoProbe.h"
 
 namespace cll = llvm::cl;
 
@@ -16,6 +18,117 @@ cll::opt<unsigned int>
                     cll::desc("IO buffer space size in MB (default: 256)"),
                     cll::init(64));
 
+cll::opt<unsigned int>
+    numIoWorkers("ioWorkers",
+                    cll::desc("Number of IO threads, shared by or split across the edge files "
+                              "(default: one per edge file)"),
+                    cll::init(0));
+
+cll::opt<blaze::IoBackend>
+    ioBackend("ioBackend",
+                    cll::desc("IO backend (default: aio)"),
+                    cll::values(
+                        clEnumValN(blaze::IO_BACKEND_AIO, "aio", "Linux native AIO"),
+                        clEnumValN(blaze::IO_BACKEND_URING, "uring", "io_uring with fixed files"),
+                        clEnumValEnd),
+                    cll::init(blaze::IO_BACKEND_AIO));
+
+cll::opt<bool>
+    ioSqPoll("ioSqPoll",
+                    cll::desc("io_uring: submit through a kernel polling thread (default: false)"),
+                    cll::init(false));
+
+cll::opt<bool>
+    ioIoPoll("ioIoPoll",
+                    cll::desc("io_uring: poll for completions, needs NVMe poll queues (default: false)"),
+                    cll::init(false));
+
+cll::opt<unsigned int>
+    ioRequestSize("ioRequestSize",
+                    cll::desc("Maximum size of a single read in kB, up to 1024, "
+                              "raised to the block size of the graph (default: 16)"),
+                    cll::init(IO_REQ_SIZE / kB));
+
+cll::opt<unsigned int>
+    ioQueueDepth("ioQueueDepth",
+                    cll::desc("Reads in flight per IO worker (default: 64)"),
+                    cll::init(IO_QUEUE_DEPTH));
+
+cll::opt<bool>
+    ioProbe("ioProbe",
+                    cll::desc("Pick queue depth and request size by probing the edge files; "
+                              "the result is cached in <index>.ioprobe (default: false)"),
+                    cll::init(false));
+
+cll::list<unsigned int>
+    ioGapPages("ioGapPages",
+                    cll::desc("Dense mode: read through holes of up to N unneeded pages; "
+                              "one value for all devices or one per device (default: 0)"),
+                    cll::CommaSeparated);
+
+cll::opt<bool>
+    ioPipeline("ioPipeline",
+                    cll::desc("Dense mode: start IO while the page frontier is built (default: false)"),
+                    cll::init(false));
+
+cll::opt<bool>
+    ioSpeculate("ioSpeculate",
+                    cll::desc("After a dense round, read its first pages again into spare IO buffers "
+                              "while the next round is prepared (default: false)"),
+                    cll::init(false));
+
+cll::opt<unsigned int>
+    inlinePages("inlinePages",
+                    cll::desc("Run edgeMap on the calling thread when a sparse frontier's edges "
+                              "span at most this many blocks, 0 to disable (default: 64)"),
+                    cll::init(INLINE_MAX_PAGES));
+
+cll::opt<unsigned int>
+    cacheSize("cacheSize",
+                    cll::desc("Edge page cache size in MB, 0 disables it (default: 0)"),
+                    cll::init(0));
+
+cll::opt<blaze::CachePolicy>
+    cachePolicy("cachePolicy",
+                    cll::desc("Edge page cache policy (default: clock)"),
+                    cll::values(
+                        clEnumValN(blaze::CACHE_CLOCK, "clock", "CLOCK eviction"),
+                        clEnumValN(blaze::CACHE_LRU, "lru", "LRU eviction"),
+                        clEnumValN(blaze::CACHE_PIN, "pin", "pin pages of the highest-degree vertices"),
+                        clEnumValEnd),
+                    cll::init(blaze::CACHE_CLOCK));
+
+cll::opt<bool>
+    inMemory("inMemory",
+                    cll::desc("Load edge files into memory and bypass the IO engine (default: false)"),
+                    cll::init(false));
+
+cll::opt<bool>
+    ioStats("ioStats",
+                    cll::desc("Print IO latency histograms and queue timelines per round (default: false)"),
+                    cll::init(false));
+
+cll::opt<bool>
+    numa("numa",
+                    cll::desc("Pin workers per NUMA node and place IO buffers and bins near their users (default: false)"),
+                    cll::init(false));
+
+cll::opt<blaze::NumaPlacement>
+    numaArrays("numaArrays",
+                    cll::desc("NUMA placement of vertex arrays (default: local)"),
+                    cll::values(
+                        clEnumValN(blaze::NUMA_LOCAL, "local", "first touch"),
+                        clEnumValN(blaze::NUMA_INTERLEAVED, "interleave", "pages round-robin over nodes"),
+                        clEnumValN(blaze::NUMA_PARTITIONED, "partition", "one contiguous block per node"),
+                        clEnumValEnd),
+                    cll::init(blaze::NUMA_LOCAL));
+
+cll::opt<bool>
+    fullOffsets("fullOffsets",
+                    cll::desc("Keep the edge offset of every vertex instead of one per 16 "
+                              "vertices, 8 bytes per vertex (default: false)"),
+                    cll::init(false));
+
 cll::opt<std::string>
     outIndexFilename(cll::Positional, cll::desc("<out index file>"), cll::Required);
 
@@ -23,14 +136,72 @@ cll::list<std::string>
     outAdjFilenames(cll::Positional, cll::desc("<out adj files>"), cll::OneOrMore);
 
 int numIoThreads;
+blaze::Config runtimeConfig;
 
 namespace blaze {
 
-void AgileStart(int argc, char** argv) {
+// Take the probe result cached next to the index or probe the edge files.
+// -ioQueueDepth and -ioRequestSize given on the command line win.
+static void probeIo() {
+    std::string path = outIndexFilename + ".ioprobe";
+    std::vector<std::string> files(outAdjFilenames.begin(), outAdjFilenames.end());
+    IoProbeResult result;
+    bool cached = IoProbe::load(path, files, &result);
+    if (!cached) {
+        result = IoProbe(files).run();
+        IoProbe::save(path, files, result);
+    }
+    printf("IO probe%s: queue depth %u, request size %u kB, %.2f GB/s, p99 %.0f us\n",
+        cached ? " (cached)" : "", result.queue_depth, result.request_size / kB,
+        result.bandwidth / GB, result.p99_us);
+
+    if (!ioQueueDepth.getNumOccurrences())
+        runtimeConfig.io_queue_depth = std::min(result.queue_depth, (uint32_t)IO_MAX_QUEUE_DEPTH);
+    if (!ioRequestSize.getNumOccurrences())
+        runtimeConfig.io_request_size = result.request_size;
+}
+
+void AgileStart(int argc, char** argv, const std::string* inIndexFilename) {
     cll::ParseCommandLineOptions(argc, argv);
-    numIoThreads = outAdjFilenames.size();
+    numIoThreads = numIoWorkers ? numIoWorkers : outAdjFilenames.size();
     int numThreads = numIoThreads + numComputeThreads;
 
+    runtimeConfig.io_backend = ioBackend;
+    runtimeConfig.io_sqpoll = ioSqPoll;
+    runtimeConfig.io_iopoll = ioIoPoll;
+
+    uint64_t request_size = (uint64_t)ioRequestSize * kB;
+    if (request_size < PAGE_SIZE || request_size > IO_MAX_REQ_SIZE || request_size % PAGE_SIZE)
+        BLAZE_DIE("ioRequestSize must be a multiple of ", PAGE_SIZE / kB, " kB up to ", IO_MAX_REQ_SIZE / kB, " kB");
+    runtimeConfig.io_request_size = request_size;
+    if (ioQueueDepth == 0 || ioQueueDepth > IO_MAX_QUEUE_DEPTH)
+        BLAZE_DIE("ioQueueDepth must be between 1 and ", IO_MAX_QUEUE_DEPTH);
+    runtimeConfig.io_queue_depth = ioQueueDepth;
+    if (ioProbe && !inMemory)
+        probeIo();
+    // a read holds at least one edge block of either graph
+    if (file_exists(outIndexFilename)) {
+        uint32_t block_size = Graph::ReadBlockSize(outIndexFilename);
+        runtimeConfig.io_request_size = std::max(runtimeConfig.io_request_size, block_size);
+    }
+    if (inIndexFilename && file_exists(*inIndexFilename)) {
+        uint32_t block_size = Graph::ReadBlockSize(*inIndexFilename);
+        runtimeConfig.io_request_size = std::max(runtimeConfig.io_request_size, block_size);
+    }
+    for (auto gap : ioGapPages) {
+        runtimeConfig.io_gap_pages.push_back(gap);
+    }
+    runtimeConfig.io_pipeline = ioPipeline;
+    runtimeConfig.io_speculate = ioSpeculate;
+    runtimeConfig.inline_max_pages = inlinePages;
+    runtimeConfig.cache_size = (uint64_t)cacheSize * MB;
+    runtimeConfig.cache_policy = cachePolicy;
+    runtimeConfig.in_memory = inMemory;
+    runtimeConfig.io_stats = ioStats;
+    runtimeConfig.numa = numa;
+    runtimeConfig.array_placement = numaArrays;
+    runtimeConfig.full_offsets = fullOffsets;
+
     // For pretty output
 //  std::locale comma_locale(std::locale(), new comma_numpunct());
 //  std::cout.imbue(comma_locale);
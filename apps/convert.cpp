@@ -6,6 +6,7 @@
 #include "Util.h"
 #include "boilerplate.h"
 #include "AsyncIo.h"
+#include "Compression.h"
 #include "Runtime.h"
 
 namespace cll = llvm::cl;
@@ -15,11 +16,27 @@ static cll::opt<int>
          cll::desc("Number of disks (default value 1)"),
          cll::init(1));
 
+static cll::opt<unsigned int>
+  blockSize("blockSize",
+         cll::desc("Edge block size in kB, a power of two from 4 to 1024 (default value 4)"),
+         cll::init(PAGE_SIZE / kB));
+
 static cll::opt<bool>
   weighted("weighted",
-         cll::desc("Flag for weighted graph (default value: false)"),
+         cll::desc("Edges with the data of the input as EdgePair tuples (default value: false)"),
+         cll::init(false));
+
+static cll::opt<bool>
+  compress("compress",
+         cll::desc("Delta and group varint coded edge blocks (default value: false)"),
          cll::init(false));
 
+static cll::opt<unsigned int>
+  alignDegree("alignDegree",
+         cll::desc("Start vertices with at least this many edges on a new block when "
+                   "their edges then span fewer blocks (default value: 0, off)"),
+         cll::init(0));
+
 
 static cll::opt<std::string>
   inputFilename(cll::Positional, cll::desc("<input file>"), cll::Required);
@@ -36,7 +53,59 @@ void get_adj_file_names(const std::string& input, int num_disks, std::vector<std
   }
 }
 
-void write_index_file(const std::string& input, std::string& out) {
+struct graph_header read_header(const std::string& input) {
+  struct graph_header header;
+  int fd = open(input.c_str(), O_RDONLY);
+  if (fd < 0) BLAZE_SYS_DIE("Failed to open ", input);
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header))
+    BLAZE_SYS_DIE("Failed to read ", input);
+  close(fd);
+  return header;
+}
+
+// Edge destinations of a .gr file are 32 bits in version 1, 64 in version 2
+bool has_vid64(const struct graph_header& header) {
+  return header.block_size == 2;
+}
+
+// Edge destinations of a .gr file, then its edge data, if any, from the
+// next 8-byte boundary
+struct GrEdges {
+  const char*     base;
+  bool            wide;
+  const EDGEDATA* data;
+
+  explicit GrEdges(const char* gr) {
+    struct graph_header *header = (struct graph_header *)gr;
+    base = gr + sizeof(*header) + sizeof(uint64_t) * header->num_nodes;
+    wide = has_vid64(*header);
+    uint64_t dst_bytes = header->num_edges * (wide ? sizeof(uint64_t) : sizeof(uint32_t));
+    data = header->flags ? (const EDGEDATA *)(base + ALIGN_UPTO(dst_bytes, sizeof(uint64_t))) : nullptr;
+  }
+
+  VID operator[](uint64_t i) const {
+    return wide ? (VID)((const uint64_t *)base)[i] : (VID)((const uint32_t *)base)[i];
+  }
+
+  // Edge i as it goes to the edge files: a VID, or an EdgePair if weighted
+  void put(char* out, uint64_t i) const {
+    if (weighted) {
+      ((EdgePair *)out)->dst = (*this)[i];
+      ((EdgePair *)out)->data = data[i];
+    } else {
+      *(VID *)out = (*this)[i];
+    }
+  }
+};
+
+uint64_t edge_tuple_size() {
+  return weighted ? sizeof(EdgePair) : sizeof(VID);
+}
+
+// starts: byte offset of the edges of each vertex and of their end, for
+// aligned or compressed edges
+void write_index_file(const std::string& input, std::string& out, uint64_t block_size,
+                      const std::vector<uint64_t>* starts) {
   char* base; size_t len;
   std::tie(base, len) = map_file(input);
 
@@ -50,6 +119,11 @@ void write_index_file(const std::string& input, std::string& out) {
 
   size_t new_len = len_header_aligned + num_offsets * CACHE_LINE;
 
+  // byte checkpoints and sizes, laid out like offsets and degrees
+  size_t len_byte_offsets = ALIGN_UPTO(num_offsets * sizeof(uint64_t), CACHE_LINE);
+  if (starts)
+    new_len += len_byte_offsets + num_offsets * CACHE_LINE;
+
   printf("# nodes: %lu\n", header->num_nodes);
   printf("[original]\n");
   printf("  index size  : %lu\n", index_file_size);
@@ -60,6 +134,10 @@ void write_index_file(const std::string& input, std::string& out) {
   printf("    offset size  : %lu\n", num_offsets * sizeof(uint64_t));
   printf("    before align : %lu\n", len_header);
   printf("+ degree size : %lu\n", num_offsets * CACHE_LINE);
+  if (starts) {
+    printf("+ byte offset size : %lu\n", len_byte_offsets);
+    printf("+ byte size size   : %lu\n", num_offsets * CACHE_LINE);
+  }
   printf("= index size  : %lu\n", new_len);
 
   char* new_base = create_and_map_file(out, new_len);
@@ -69,8 +147,13 @@ void write_index_file(const std::string& input, std::string& out) {
   uint64_t offset;
 
   uint64_t *np = (uint64_t *)new_base;
-  *np++ = 0;
-  *np++ = 0;
+  *np++ = block_size;
+  uint64_t flags = sizeof(VID) == 8 ? GRAPH_VID64 : 0;
+  if (starts)
+    flags |= GRAPH_BYTE_INDEX | (compress ? GRAPH_COMPRESSED : 0);
+  if (weighted)
+    flags |= GRAPH_WEIGHTED;
+  *np++ = flags;
   *np++ = header->num_nodes;
   *np++ = header->num_edges;
 
@@ -93,13 +176,27 @@ void write_index_file(const std::string& input, std::string& out) {
     degrees[node] = degree;
   }
 
+  if (starts) {
+    uint64_t *byte_offsets = (uint64_t *)(new_base + len_header_aligned + num_offsets * CACHE_LINE);
+    uint32_t *sizes = (uint32_t *)((char *)byte_offsets + len_byte_offsets);
+    for (uint64_t node = 0; node < header->num_nodes; node++) {
+      uint64_t size = (*starts)[node + 1] - (*starts)[node];
+      if (size > UINT32_MAX)
+        BLAZE_DIE("Edges of vertex ", node, " take more than 4 GB");
+      if (node % 16 == 0) {
+        byte_offsets[node / 16] = (*starts)[node];
+      }
+      sizes[node] = size;
+    }
+  }
+
   munmap(base, len);
 
   msync(new_base, new_len, MS_SYNC);
   munmap(new_base, new_len);
 }
 
-void write_adj_files(const std::string& input, std::vector<std::string>& out_files) {
+void write_adj_files(const std::string& input, std::vector<std::string>& out_files, uint64_t block_size) {
   char* base; size_t len;
   std::tie(base, len) = map_file(input);
   uint64_t* p = (uint64_t*)base;
@@ -110,11 +207,8 @@ void write_adj_files(const std::string& input, std::vector<std::string>& out_fil
   uint64_t edge_starts = sizeof(uint64_t) * (4 + num_nodes);
 
   int num_disks = out_files.size();
-  uint64_t tuple_size = sizeof(VID);
-  if (weighted)
-    tuple_size += sizeof(EDGEDATA);
-  uint64_t total_edge_bytes = num_edges * tuple_size;
-  uint64_t total_num_pages = (total_edge_bytes - 1) / PAGE_SIZE + 1;
+  uint64_t total_edge_bytes = num_edges * sizeof(VID);
+  uint64_t total_num_pages = (total_edge_bytes - 1) / block_size + 1;
   uint64_t num_pages_per_disk = total_num_pages / num_disks;    // FIXME may not be equal
 
   int fd[num_disks];
@@ -125,17 +219,17 @@ void write_adj_files(const std::string& input, std::vector<std::string>& out_fil
   char* buf = base + edge_starts;
   const char* buf_end = buf + total_edge_bytes;
 
+  std::vector<char> zeros(block_size, 0);
   uint64_t page_cnt = 0;
   while (buf < buf_end) {
-    size_t len = PAGE_SIZE; 
+    size_t len = block_size;
     if (buf + len > buf_end)
       len = buf_end - buf;
     write(fd[page_cnt % num_disks], buf, len);
-    if (len < PAGE_SIZE) {
-      char tmp[PAGE_SIZE - len];
-      write(fd[page_cnt % num_disks], tmp, PAGE_SIZE - len);
+    if (len < block_size) {
+      write(fd[page_cnt % num_disks], zeros.data(), block_size - len);
     }
-    buf += PAGE_SIZE;
+    buf += block_size;
     page_cnt++;
   }
 
@@ -146,15 +240,203 @@ void write_adj_files(const std::string& input, std::vector<std::string>& out_fil
   munmap(base, len);
 }
 
-void convert(const std::string& input, int num_disks) {
-  // write index file
-  auto index_file_name = get_index_file_name(input);
-  write_index_file(input, index_file_name);
+// Edges converted one by one: ids of the other width than VID, or edges
+// with their data
+void write_converted_adj_files(const std::string& input, std::vector<std::string>& out_files,
+                               uint64_t block_size) {
+  char* base; size_t len;
+  std::tie(base, len) = map_file(input);
+  struct graph_header *header = (struct graph_header *)base;
+  GrEdges edges(base);
 
-  // write adj files
+  int num_disks = out_files.size();
+  int fd[num_disks];
+  for (int i = 0; i < num_disks; i++) {
+    fd[i] = open(out_files[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+
+  uint64_t tuple_size = edge_tuple_size();
+  uint64_t edges_per_block = block_size / tuple_size;
+  std::vector<char> block(block_size);
+  uint64_t num_blocks = 0;
+  for (uint64_t e = 0; e < header->num_edges; e += edges_per_block) {
+    uint64_t n = std::min(header->num_edges - e, edges_per_block);
+    std::fill(block.begin(), block.end(), 0);
+    for (uint64_t i = 0; i < n; i++) {
+      edges.put(block.data() + i * tuple_size, e + i);
+    }
+    int disk_id = num_blocks++ % num_disks;
+    if (write(fd[disk_id], block.data(), block_size) != (ssize_t)block_size)
+      BLAZE_SYS_DIE("Failed to write ", out_files[disk_id]);
+  }
+
+  for (int i = 0; i < num_disks; i++) {
+    close(fd[i]);
+  }
+
+  munmap(base, len);
+}
+
+// Whether edges of the given bytes, room left in the current block and
+// capacity of a new one, span fewer blocks from a new block
+bool should_align(uint32_t degree, uint64_t bytes, uint64_t room, uint64_t capacity) {
+  if (!alignDegree || degree < alignDegree || room == capacity || bytes <= room)
+    return false;
+  uint64_t blocks = 1 + (bytes - room + capacity - 1) / capacity;
+  uint64_t aligned_blocks = (bytes + capacity - 1) / capacity;
+  return aligned_blocks < blocks;
+}
+
+void print_alignment(uint64_t num_aligned, uint64_t padding, uint64_t total) {
+  printf("[aligned]\n");
+  printf("  vertices    : %lu (-alignDegree %u)\n", num_aligned, alignDegree.getValue());
+  printf("  padding     : %lu (%.2f%%)\n", padding, (double)padding * 100.0 / std::max(total, (uint64_t)1));
+}
+
+// Raw edges, with vertices moved to a new block by should_align; fills in
+// starts for the index
+void write_aligned_adj_files(const std::string& input, std::vector<std::string>& out_files,
+                             uint64_t block_size, std::vector<uint64_t>& starts) {
+  char* base; size_t len;
+  std::tie(base, len) = map_file(input);
+  struct graph_header *header = (struct graph_header *)base;
+  uint64_t num_nodes = header->num_nodes;
+  uint64_t *index = (uint64_t *)(base + sizeof(*header));
+  GrEdges edges(base);
+
+  int num_disks = out_files.size();
+  int fd[num_disks];
+  for (int i = 0; i < num_disks; i++) {
+    fd[i] = open(out_files[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+
+  std::vector<char> block(block_size, 0);
+  uint64_t num_blocks = 0, pos = 0, padding = 0, num_aligned = 0;
+  auto next_block = [&]() {
+    int disk_id = num_blocks % num_disks;
+    if (write(fd[disk_id], block.data(), block_size) != (ssize_t)block_size)
+      BLAZE_SYS_DIE("Failed to write ", out_files[disk_id]);
+    std::fill(block.begin(), block.end(), 0);
+    num_blocks++;
+    pos = 0;
+  };
+
+  uint64_t tuple_size = edge_tuple_size();
+  starts.resize(num_nodes + 1);
+  for (uint64_t node = 0; node < num_nodes; node++) {
+    uint64_t beg = node ? index[node - 1] : 0;
+    uint32_t degree = index[node] - beg;
+    uint64_t bytes = (uint64_t)degree * tuple_size;
+    if (should_align(degree, bytes, block_size - pos, block_size)) {
+      padding += block_size - pos;
+      num_aligned++;
+      next_block();
+    }
+    starts[node] = num_blocks * block_size + pos;
+
+    for (uint64_t e = beg; e < index[node]; e++) {
+      edges.put(block.data() + pos, e);
+      pos += tuple_size;
+      if (pos == block_size)
+        next_block();
+    }
+  }
+  starts[num_nodes] = num_blocks * block_size + pos;
+  if (pos)
+    next_block();
+
+  print_alignment(num_aligned, padding, num_blocks * block_size);
+
+  for (int i = 0; i < num_disks; i++) {
+    close(fd[i]);
+  }
+
+  munmap(base, len);
+}
+
+// Sorted neighbors of each vertex, coded block by block (Compression.h);
+// fills in starts for the index
+void write_compressed_adj_files(const std::string& input, std::vector<std::string>& out_files,
+                                uint64_t block_size, std::vector<uint64_t>& starts) {
+  char* base; size_t len;
+  std::tie(base, len) = map_file(input);
+  struct graph_header *header = (struct graph_header *)base;
+  uint64_t num_nodes = header->num_nodes;
+  uint64_t *index = (uint64_t *)(base + sizeof(*header));
+  GrEdges edges(base);
+
+  int num_disks = out_files.size();
+  int fd[num_disks];
+  for (int i = 0; i < num_disks; i++) {
+    fd[i] = open(out_files[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+
+  CompressedEdgeWriter writer(block_size,
+                              [&](const char* block) {
+                                int disk_id = writer.getNumBlocks() % num_disks;
+                                if (write(fd[disk_id], block, block_size) != (ssize_t)block_size)
+                                  BLAZE_SYS_DIE("Failed to write ", out_files[disk_id]);
+                              });
+
+  std::vector<VID> sorted;
+  uint64_t padding = 0, num_aligned = 0;
+  starts.resize(num_nodes + 1);
+  for (uint64_t node = 0; node < num_nodes; node++) {
+    uint64_t beg = node ? index[node - 1] : 0;
+    sorted.clear();
+    for (uint64_t e = beg; e < index[node]; e++) {
+      sorted.push_back(edges[e]);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    // by the size without restarts, which may take a few bytes more
+    if (should_align(sorted.size(), GroupVarint::encodedSize(sorted.data(), sorted.size()),
+                     writer.getRoom(), writer.getCapacity())) {
+      padding += writer.getRoom();
+      num_aligned++;
+      writer.alignBlock();
+    }
+    starts[node] = writer.addVertex(sorted.data(), sorted.size());
+  }
+  starts[num_nodes] = writer.finish();
+
+  printf("[compressed]\n");
+  printf("  edge size   : %lu (%.2f bytes per edge)\n", writer.getNumBlocks() * block_size,
+         (double)writer.getNumBlocks() * block_size / std::max(header->num_edges, (uint64_t)1));
+  printf("  raw size    : %lu\n", header->num_edges * sizeof(VID));
+  if (alignDegree)
+    print_alignment(num_aligned, padding, writer.getNumBlocks() * block_size);
+
+  for (int i = 0; i < num_disks; i++) {
+    close(fd[i]);
+  }
+
+  munmap(base, len);
+}
+
+void convert(const std::string& input, int num_disks, uint64_t block_size) {
+  auto index_file_name = get_index_file_name(input);
   std::vector<std::string> adj_file_names;
   get_adj_file_names(input, num_disks, adj_file_names);
-  write_adj_files(input, adj_file_names);
+
+  // the index of aligned or compressed edges needs where they went
+  if (compress || alignDegree) {
+    std::vector<uint64_t> starts;
+    if (compress)
+      write_compressed_adj_files(input, adj_file_names, block_size, starts);
+    else
+      write_aligned_adj_files(input, adj_file_names, block_size, starts);
+    write_index_file(input, index_file_name, block_size, &starts);
+    return;
+  }
+
+  // write index file
+  write_index_file(input, index_file_name, block_size, nullptr);
+
+  // write adj files
+  if (weighted || has_vid64(read_header(input)) != (sizeof(VID) == 8))
+    write_converted_adj_files(input, adj_file_names, block_size);
+  else
+    write_adj_files(input, adj_file_names, block_size);
 }
 
 
@@ -165,7 +447,21 @@ int main(int argc, char **argv) {
   galois::StatTimer timer("Time", "CONVERT");
   timer.start();
 
-  convert(inputFilename, numDisks);
+  uint64_t block_size = (uint64_t)blockSize * kB;
+  if (block_size < PAGE_SIZE || block_size > MAX_BLOCK_SIZE || (block_size & (block_size - 1)))
+    BLAZE_DIE("blockSize must be a power of two from ", PAGE_SIZE / kB, " to ", MAX_BLOCK_SIZE / kB, " kB");
+  if (compress && weighted)
+    BLAZE_DIE("compressed edges carry no weights");
+
+  struct graph_header header = read_header(inputFilename);
+  if (header.num_nodes > (uint64_t)std::numeric_limits<VID>::max())
+    BLAZE_DIE(header.num_nodes, " vertices, build with -DBLAZE_VID64=ON");
+  if (compress && sizeof(VID) == 8)
+    BLAZE_DIE("compressed edges hold 32-bit vertex ids, build without BLAZE_VID64");
+  if (weighted && header.flags != sizeof(EDGEDATA))
+    BLAZE_DIE(inputFilename, ": ", header.flags, "-byte edge data, EDGEDATA takes ", sizeof(EDGEDATA));
+
+  convert(inputFilename, numDisks, block_size);
 
   timer.stop();
 
@@ -99,13 +99,13 @@ public:
 };
 
 template <typename Graph>
-void findLargest(Graph& graph, blaze::Array<uint32_t>& data) {
+void findLargest(Graph& graph, blaze::Array<VID>& data) {
 
     using ReducerMap =
-            galois::GMapPerItemReduce<uint32_t, int, std::plus<int>>;
+            galois::GMapPerItemReduce<VID, int, std::plus<int>>;
     using Map = typename ReducerMap::container_type;
 
-    using ComponentSizePair = std::pair<uint32_t, int>;
+    using ComponentSizePair = std::pair<VID, int>;
 
     ReducerMap accumMap;
     galois::GAccumulator<size_t> accumReps;
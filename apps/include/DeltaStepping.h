@@ -0,0 +1,185 @@
+#ifndef AGILE_DELTA_STEPPING_H
+#define AGILE_DELTA_STEPPING_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "galois/Reduction.h"
+#include "Type.h"
+#include "Graph.h"
+#include "atomics.h"
+#include "Array.h"
+#include "Worklist.h"
+
+namespace blaze {
+
+typedef uint32_t DIST;
+const DIST DIST_INF = (DIST)-1;
+
+// dist = min(dist, val); true if it went down
+inline bool write_min(DIST& dist, DIST val) {
+    DIST old = dist;
+    while (val < old) {
+        if (compare_and_swap(dist, old, val))
+            return true;
+        old = dist;
+    }
+    return false;
+}
+
+// Tentative distance over an edge of nonnegative data
+inline DIST relax(DIST dist, EDGEDATA data) {
+    uint64_t d = (uint64_t)dist + (uint64_t)data;
+    return d < DIST_INF ? d : DIST_INF - 1;
+}
+
+// Buckets with at most n / SPARSE_BUCKET_RATIO live entries are handed
+// out as sorted sparse frontiers, larger ones through a bitmap
+constexpr static const uint64_t SPARSE_BUCKET_RATIO = 64;
+
+/*
+ * Bucketed frontiers of delta-stepping. Bucket b holds the vertices at a
+ * distance in [b << shift, (b + 1) << shift). A vertex goes into the
+ * bucket of its distance each time the distance goes down; copies left in
+ * other buckets are stale and dropped when those are taken. The buckets
+ * after the current one are bags in a window of num_buckets, later ones
+ * go to an overflow bag that fills the next window.
+ */
+class Buckets {
+ public:
+    Buckets(Array<DIST>& dist, uint64_t n, int shift, int num_buckets):
+        _dist(dist), _n(n), _shift(shift), _window(num_buckets),
+        _base(0), _cur(0), _overflow(0) {}
+
+    void insert(VID v) {
+        uint64_t b = bucketOf(v);
+        if (b < _base + _window.size())
+            _window[b % _window.size()].push(v);
+        else
+            _overflow_bags[_overflow].push(v);
+    }
+
+    // The vertices of the lowest nonempty bucket, nullptr when all are
+    // empty. The bucket stays current while edgeMap refills it.
+    Worklist<VID>* next() {
+        while (true) {
+            for (; _cur < _base + _window.size(); _cur++) {
+                auto& bag = _window[_cur % _window.size()];
+                if (bag.empty())
+                    continue;
+                galois::GAccumulator<uint64_t> live;
+                galois::do_all(galois::iterate(bag),
+                                [&](const VID& v) {
+                                    if (bucketOf(v) == _cur)
+                                        live += 1;
+                                }, galois::no_stats());
+                if (!live.reduce()) {
+                    bag.clear();
+                    continue;
+                }
+                Worklist<VID>* frontier = new Worklist<VID>(_n);
+                if (live.reduce() > _n / SPARSE_BUCKET_RATIO) {
+                    frontier->to_dense();
+                    galois::do_all(galois::iterate(bag),
+                                    [&](const VID& v) {
+                                        if (bucketOf(v) == _cur)
+                                            frontier->activate(v);
+                                    }, galois::no_stats(), galois::steal());
+                } else {
+                    // a vertex is in the bag each time its distance went
+                    // down within the bucket
+                    std::vector<VID> members;
+                    members.reserve(live.reduce());
+                    for (VID v : bag) {
+                        if (bucketOf(v) == _cur)
+                            members.push_back(v);
+                    }
+                    std::sort(members.begin(), members.end());
+                    members.erase(std::unique(members.begin(), members.end()), members.end());
+                    for (VID v : members) {
+                        frontier->activate(v);
+                    }
+                }
+                bag.clear();
+                return frontier;
+            }
+            if (!refill())
+                return nullptr;
+        }
+    }
+
+ private:
+    uint64_t bucketOf(VID v) const {
+        return _dist[v] >> _shift;
+    }
+
+    // Move the window to the lowest live bucket of the overflow
+    bool refill() {
+        auto& overflow = _overflow_bags[_overflow];
+        galois::GReduceMin<uint64_t> lowest;
+        galois::do_all(galois::iterate(overflow),
+                        [&](const VID& v) {
+                            uint64_t b = bucketOf(v);
+                            if (b >= _cur)
+                                lowest.update(b);
+                        }, galois::no_stats());
+        uint64_t b = lowest.reduce();
+        if (overflow.empty() || b == std::numeric_limits<uint64_t>::max()) {
+            overflow.clear();
+            return false;
+        }
+
+        _base = _cur = b;
+        _overflow ^= 1;
+        galois::do_all(galois::iterate(overflow),
+                        [&](const VID& v) {
+                            if (bucketOf(v) >= _cur)
+                                insert(v);
+                        }, galois::no_stats());
+        overflow.clear();
+        return true;
+    }
+
+ private:
+    Array<DIST>&                            _dist;
+    uint64_t                                _n;
+    int                                     _shift;
+    std::vector<galois::InsertBag<VID>>     _window;
+    uint64_t                                _base;      // first bucket of the window
+    uint64_t                                _cur;
+    galois::InsertBag<VID>                  _overflow_bags[2];
+    int                                     _overflow;  // the bag insert fills
+};
+
+struct SSSP_Vertex_Init {
+    Array<DIST>& dist;
+    Array<bool>& changed;
+
+    SSSP_Vertex_Init(Array<DIST>& d, Array<bool>& c): dist(d), changed(c) {}
+
+    inline bool operator() (const VID& node) {
+        dist[node] = DIST_INF;
+        changed[node] = false;
+        return true;
+    }
+};
+
+// Print the reach of the search
+inline void printDistances(Graph& graph, Array<DIST>& dist) {
+    galois::GAccumulator<uint64_t> reached;
+    galois::GReduceMax<DIST> longest;
+    galois::do_all(galois::iterate(graph),
+                    [&](const VID& v) {
+                        if (dist[v] != DIST_INF) {
+                            reached += 1;
+                            longest.update(dist[v]);
+                        }
+                    }, galois::no_stats());
+    printf("Reached: %lu, max distance: %u\n", reached.reduce(), longest.reduce());
+}
+
+} // namespace blaze
+
+#endif // AGILE_DELTA_STEPPING_H
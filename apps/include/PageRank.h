@@ -49,7 +49,7 @@ void printTop(Array<Node>& data, unsigned topn = PRINT_TOP) {
     for (auto ii = top.rbegin(), ei = top.rend(); ii != ei; ++ii, ++rank) {
         float value = ii->first.value;
         VID node = ii->first.id;
-        printf("%3d: %20.10f %10u\n", rank, value, node);
+        printf("%3d: %20.10f %10lu\n", rank, value, (uint64_t)node);
     }
 }
 
@@ -3,15 +3,19 @@
 
 #include "llvm/Support/CommandLine.h"
 #include "Bin.h"
+#include "Config.h"
 
 extern llvm::cl::opt<int> numComputeThreads;
 extern llvm::cl::opt<unsigned int> ioBufferSize;
 extern llvm::cl::opt<std::string> outIndexFilename;
 extern llvm::cl::list<std::string> outAdjFilenames;
 extern int numIoThreads;
+extern blaze::Config runtimeConfig;
 
 namespace blaze {
 
+// Base of edge functions. Ones that take the edge data as well define
+// updateAtomic(src, dst, data) or scatter(src, dst, data) instead.
 template <typename T = uint32_t>
 struct EDGEMAP_F {
     Bins* bins;
@@ -47,7 +51,9 @@ struct EDGEMAP_F {
     typedef T value_type;
 };
 
-void AgileStart(int argc, char** argv);
+// Parses the command line into runtimeConfig. Apps that also read an
+// in-graph pass its index option so reads fit its edge blocks too.
+void AgileStart(int argc, char** argv, const std::string* inIndexFilename = nullptr);
 
 } // namespace blaze
 
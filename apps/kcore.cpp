@@ -100,8 +100,8 @@ struct Deg_AtLeast_K {
 };
 
 int main(int argc, char **argv) {
-    AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    AgileStart(argc, argv, &inIndexFilename);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
 
     Graph outGraph;
     outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
@@ -137,8 +137,7 @@ int main(int argc, char **argv) {
                 break;
 
             } else {
-                edgeMap(outGraph, to_remove, Update_Deg(degrees), no_output);
-                edgeMap(inGraph, to_remove, Update_Deg(degrees), no_output);
+                edgeMap(outGraph, inGraph, to_remove, Update_Deg(degrees), no_output);
                 delete to_remove;
             }
         }
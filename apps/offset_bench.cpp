@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include "llvm/Support/CommandLine.h"
+#include "galois/Galois.h"
+#include "Type.h"
+#include "Graph.h"
+#include "Util.h"
+#include "boilerplate.h"
+#include "Runtime.h"
+
+using namespace blaze;
+namespace cll = llvm::cl;
+
+static cll::opt<unsigned int>
+    numLookups("lookups",
+               cll::desc("Number of random lookups (default: 16M)"),
+               cll::init(16 << 20));
+
+static cll::opt<unsigned int>
+    numRepeats("repeats",
+               cll::desc("Runs of each benchmark, the fastest is reported (default: 5)"),
+               cll::init(5));
+
+// Graph::GetOffset before the block sum: the checkpoint of the block of 16
+// plus a loop over the degrees before node
+struct ScanOffsets {
+    Graph& graph;
+    std::vector<uint64_t> checkpoints;
+
+    ScanOffsets(Graph& g): graph(g) {
+        uint64_t num_blocks = ((uint64_t)g.NumberOfNodes() + 15) / 16;
+        checkpoints.resize(num_blocks);
+        for (uint64_t b = 0; b < num_blocks; b++) {
+            checkpoints[b] = g.GetOffset(b * 16);
+        }
+    }
+
+    uint64_t operator()(VID node) const {
+        uint64_t offset = checkpoints[node >> 4];
+        VID beg = (node >> 4) << 4;
+        while (beg < node) {
+            offset += graph.GetDegree(beg++);
+        }
+        return offset;
+    }
+};
+
+// Fastest of numRepeats runs of fn in ns per item
+template <typename F>
+static void measure(const char* name, uint64_t items, uint64_t* checksum, F fn) {
+    double best = 0.0;
+    for (unsigned r = 0; r < numRepeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sum = fn();
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        double ns = duration.count() * 1e9 / items;
+        if (!r || ns < best)
+            best = ns;
+        if (r && sum != *checksum)
+            BLAZE_DIE(name, ": results differ between runs");
+        *checksum = sum;
+    }
+    printf("  %-28s: %8.2f ns\n", name, best);
+}
+
+static void lookups(const char* title, const std::vector<VID>& nodes,
+                    const ScanOffsets& scan, Graph& block, Graph& full) {
+    uint64_t expected, sum;
+    printf("%s, per lookup:\n", title);
+    measure("scan (before)", nodes.size(), &expected, [&] {
+        uint64_t s = 0;
+        for (VID node : nodes) s += scan(node);
+        return s;
+    });
+    measure("block sum", nodes.size(), &sum, [&] {
+        uint64_t s = 0;
+        for (VID node : nodes) s += block.GetOffset(node);
+        return s;
+    });
+    if (sum != expected)
+        BLAZE_DIE("block sum: wrong offsets");
+    measure("full index (-fullOffsets)", nodes.size(), &sum, [&] {
+        uint64_t s = 0;
+        for (VID node : nodes) s += full.GetOffset(node);
+        return s;
+    });
+    if (sum != expected)
+        BLAZE_DIE("full index: wrong offsets");
+}
+
+int main(int argc, char **argv) {
+    AgileStart(argc, argv);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
+
+    fullOffsetIndex = false;
+    Graph block;
+    block.BuildGraph(outIndexFilename, outAdjFilenames);
+
+    fullOffsetIndex = true;
+    Graph full;
+    full.BuildGraph(outIndexFilename, outAdjFilenames);
+
+    ScanOffsets scan(block);
+    uint64_t n = block.NumberOfNodes();
+
+    std::vector<VID> sequential(n);
+    for (uint64_t i = 0; i < n; i++) {
+        sequential[i] = i;
+    }
+    std::vector<VID> random(numLookups);
+    std::mt19937_64 rng(1);
+    for (auto& node : random) {
+        node = rng() % n;
+    }
+
+    lookups("Sequential vertices", sequential, scan, block, full);
+    lookups("Random vertices", random, scan, block, full);
+
+    // The vertex loop of processFetchedPage over every page of the graph
+    uint64_t num_pages = block.GetTotalNumPages();
+    VidRange* p2v_map = &block.GetP2VMap();
+    uint64_t expected, sum;
+    printf("Page walk, per page:\n");
+    measure("offset per vertex (before)", num_pages, &expected, [&] {
+        uint64_t s = 0;
+        for (PAGEID pid = 0; pid < num_pages; pid++) {
+            for (VID vid = p2v_map[pid].first; vid <= p2v_map[pid].second; vid++) {
+                s += scan(vid) + block.GetDegree(vid);
+            }
+        }
+        return s;
+    });
+    measure("page cursor", num_pages, &sum, [&] {
+        uint64_t s = 0;
+        for (PAGEID pid = 0; pid < num_pages; pid++) {
+            VID vid = p2v_map[pid].first;
+            uint64_t offset = block.GetOffset(vid);
+            for (; vid <= p2v_map[pid].second; vid++) {
+                uint32_t degree = block.GetDegree(vid);
+                s += offset + degree;
+                offset += degree;
+            }
+        }
+        return s;
+    });
+    if (sum != expected)
+        BLAZE_DIE("page cursor: wrong offsets");
+
+    return 0;
+}
@@ -163,7 +163,7 @@ struct PR_TotalDelta {
 
 int main(int argc, char **argv) {
     AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
     runtime.initBinning(binningRatio);
 
     Graph outGraph;
@@ -156,8 +156,8 @@ void processPage(MemGraph& graph, Func& func, PAGEID pid, char* buffer) {
     const VID vid_start = p2v_map[pid].first;
     const VID vid_end   = p2v_map[pid].second;
 
-    const uint64_t page_start = (uint64_t)pid * PAGE_SIZE;
-    const uint64_t page_end = page_start + PAGE_SIZE;
+    const uint64_t page_start = (uint64_t)pid * graph.GetBlockSize();
+    const uint64_t page_end = page_start + graph.GetBlockSize();
 
     VID vid = vid_start;
     while (vid <= vid_end) {
@@ -98,7 +98,7 @@ struct SPMV_VertexApply {
 
 int main(int argc, char **argv) {
     AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
     runtime.initBinning(binningRatio);
 
     Graph outGraph;
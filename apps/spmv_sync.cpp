@@ -89,7 +89,7 @@ struct SPMV_VertexApply {
 
 int main(int argc, char **argv) {
     AgileStart(argc, argv);
-    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
 
     Graph outGraph;
     outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <string>
+#include "llvm/Support/CommandLine.h"
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "Type.h"
+#include "Graph.h"
+#include "atomics.h"
+#include "Array.h"
+#include "Util.h"
+#include "EdgeMap.h"
+#include "VertexMap.h"
+#include "boilerplate.h"
+#include "Runtime.h"
+#include "DeltaStepping.h"
+
+using namespace blaze;
+namespace cll = llvm::cl;
+
+static cll::opt<unsigned int>
+    startNode("startNode",
+            cll::desc("Node to start search from (default value 0)"),
+            cll::init(0));
+
+static cll::opt<unsigned int>
+    deltaShift("deltaShift",
+            cll::desc("Buckets span 2^deltaShift of distance (default value 13)"),
+            cll::init(13));
+
+static cll::opt<int>
+    numBuckets("numBuckets",
+            cll::desc("Number of open buckets (default value 128)"),
+            cll::init(128));
+
+static cll::opt<unsigned int>
+        binSpace("binSpace",
+                cll::desc("Size of bin space in MB (default: 256)"),
+                cll::init(256));
+
+static cll::opt<int>
+        binCount("binCount",
+                cll::desc("Number of bins (default: 4096)"),
+                cll::init(BIN_COUNT));
+
+static cll::opt<int>
+        binBufSize("binBufSize",
+                cll::desc("Size of a bin buffer (default: 128)"),
+                cll::init(BIN_BUF_SIZE));
+
+static cll::opt<float>
+        binningRatio("binningRatio",
+                cll::desc("Binning worker ratio (default: 0.67)"),
+                cll::init(BINNING_WORKER_RATIO));
+
+struct SSSP_F : public EDGEMAP_F<DIST> {
+    Array<DIST>& dist;
+    Array<bool>& changed;
+
+    SSSP_F(Array<DIST>& d, Array<bool>& c, Bins* b): dist(d), changed(c), EDGEMAP_F(b) {}
+
+    inline DIST scatter(VID src, VID dst, EDGEDATA data) {
+        return relax(dist[src], data);
+    }
+
+    // Apply a binned distance; true only for the first change of dst
+    // this round, so it enters the output frontier once
+    inline bool gather(VID dst, DIST val) {
+        if (val < dist[dst]) {
+            dist[dst] = val;
+            if (!changed[dst]) {
+                changed[dst] = true;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+int main(int argc, char **argv) {
+    AgileStart(argc, argv);
+    if (numBuckets <= 0)
+        BLAZE_DIE("numBuckets must be positive");
+    if (deltaShift >= sizeof(DIST) * 8)
+        BLAZE_DIE("deltaShift must be below ", sizeof(DIST) * 8);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
+    runtime.initBinning(binningRatio);
+
+    Graph outGraph;
+    outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
+
+    uint64_t n = outGraph.NumberOfNodes();
+
+    Array<DIST> dist;
+    dist.allocate(n);
+    Array<bool> changed;
+    changed.allocate(n);
+
+    // Allocate bins
+    unsigned nthreads = galois::getActiveThreads();
+    uint64_t binSpaceBytes = (uint64_t)binSpace * MB;
+    Bins *bins = new Bins(outGraph, nthreads, binSpaceBytes,
+                          binCount, binBufSize, binningRatio);
+
+    vertexMap(outGraph, SSSP_Vertex_Init(dist, changed));
+
+    dist[startNode] = 0;
+
+    Buckets buckets(dist, n, deltaShift, numBuckets);
+    buckets.insert(startNode);
+
+    galois::StatTimer time("Time", "SSSP_MAIN");
+    time.start();
+
+    // vertices whose distance went down go back to the buckets
+    Worklist<VID>* frontier;
+    while ((frontier = buckets.next()) != nullptr) {
+        Worklist<VID>* output = edgeMap(outGraph, frontier, SSSP_F(dist, changed, bins), prop_blocking);
+        vertexMap(output, [&](VID v) {
+                              changed[v] = false;
+                              buckets.insert(v);
+                          });
+        delete output;
+        delete frontier;
+    }
+
+    time.stop();
+
+    delete bins;
+
+    printDistances(outGraph, dist);
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <string>
+#include "llvm/Support/CommandLine.h"
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "Type.h"
+#include "Graph.h"
+#include "atomics.h"
+#include "Array.h"
+#include "Util.h"
+#include "EdgeMap.h"
+#include "VertexMap.h"
+#include "boilerplate.h"
+#include "Runtime.h"
+#include "DeltaStepping.h"
+
+using namespace blaze;
+namespace cll = llvm::cl;
+
+static cll::opt<unsigned int>
+    startNode("startNode",
+            cll::desc("Node to start search from (default value 0)"),
+            cll::init(0));
+
+static cll::opt<unsigned int>
+    deltaShift("deltaShift",
+            cll::desc("Buckets span 2^deltaShift of distance (default value 13)"),
+            cll::init(13));
+
+static cll::opt<int>
+    numBuckets("numBuckets",
+            cll::desc("Number of open buckets (default value 128)"),
+            cll::init(128));
+
+struct SSSP_F : public EDGEMAP_F<DIST> {
+    Array<DIST>& dist;
+    Array<bool>& changed;
+
+    SSSP_F(Array<DIST>& d, Array<bool>& c): dist(d), changed(c) {}
+
+    // Lower the distance of dst over the edge; true only for the first
+    // change of dst this round, so it enters the output frontier once
+    inline bool updateAtomic(VID src, VID dst, EDGEDATA data) {
+        return write_min(dist[dst], relax(dist[src], data))
+                && compare_and_swap(changed[dst], false, true);
+    }
+};
+
+int main(int argc, char **argv) {
+    AgileStart(argc, argv);
+    if (numBuckets <= 0)
+        BLAZE_DIE("numBuckets must be positive");
+    if (deltaShift >= sizeof(DIST) * 8)
+        BLAZE_DIE("deltaShift must be below ", sizeof(DIST) * 8);
+    Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
+
+    Graph outGraph;
+    outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
+
+    uint64_t n = outGraph.NumberOfNodes();
+
+    Array<DIST> dist;
+    dist.allocate(n);
+    Array<bool> changed;
+    changed.allocate(n);
+
+    vertexMap(outGraph, SSSP_Vertex_Init(dist, changed));
+
+    dist[startNode] = 0;
+
+    Buckets buckets(dist, n, deltaShift, numBuckets);
+    buckets.insert(startNode);
+
+    galois::StatTimer time("Time", "SSSP_MAIN");
+    time.start();
+
+    // vertices whose distance went down go back to the buckets
+    Worklist<VID>* frontier;
+    while ((frontier = buckets.next()) != nullptr) {
+        Worklist<VID>* output = edgeMap(outGraph, frontier, SSSP_F(dist, changed), 0);
+        vertexMap(output, [&](VID v) {
+                              changed[v] = false;
+                              buckets.insert(v);
+                          });
+        delete output;
+        delete frontier;
+    }
+
+    time.stop();
+
+    printDistances(outGraph, dist);
+
+    return 0;
+}
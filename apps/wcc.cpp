@@ -47,17 +47,17 @@ static cll::opt<float>
                 cll::init(BINNING_WORKER_RATIO));
 
 
-struct WCC_F : public EDGEMAP_F<uint32_t> {
-	Array<uint32_t>& ids;
+struct WCC_F : public EDGEMAP_F<VID> {
+	Array<VID>& ids;
 
-	WCC_F(Array<uint32_t>& i, Bins* b): ids(i), EDGEMAP_F(b) {}
+	WCC_F(Array<VID>& i, Bins* b): ids(i), EDGEMAP_F(b) {}
 
-    inline uint32_t scatter(VID src, VID dst) {
+    inline VID scatter(VID src, VID dst) {
         return ids[src];
     }
 
-    inline bool gather(VID dst, uint32_t val) {
-		uint32_t orig_id = ids[dst];
+    inline bool gather(VID dst, VID val) {
+		VID orig_id = ids[dst];
 		if (val < orig_id) {
 			ids[dst] = val;
 		}
@@ -70,13 +70,13 @@ struct WCC_F : public EDGEMAP_F<uint32_t> {
 };
 
 struct WCC_Shortcut {
-	Array<uint32_t>& ids;
-	Array<uint32_t>& prev_ids;
+	Array<VID>& ids;
+	Array<VID>& prev_ids;
 
-	WCC_Shortcut(Array<uint32_t>& i, Array<uint32_t>& p): ids(i), prev_ids(p) {}
+	WCC_Shortcut(Array<VID>& i, Array<VID>& p): ids(i), prev_ids(p) {}
 
 	inline bool operator() (const VID& node) {
-		uint32_t l = ids[ids[node]];
+		VID l = ids[ids[node]];
 		if (ids[node] != l)
 			ids[node] = l;
 
@@ -91,8 +91,8 @@ struct WCC_Shortcut {
 };
 
 int main(int argc, char **argv) {
-	AgileStart(argc, argv);
-	Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+	AgileStart(argc, argv, &inIndexFilename);
+	Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
     runtime.initBinning(binningRatio);
 
 	Graph outGraph;
@@ -103,8 +103,8 @@ int main(int argc, char **argv) {
 
 	uint64_t n = outGraph.NumberOfNodes();
 
-	Array<uint32_t> ids;
-	Array<uint32_t> prev_ids;
+	Array<VID> ids;
+	Array<VID> prev_ids;
 	ids.allocate(n);
 	prev_ids.allocate(n);
 
@@ -127,9 +127,7 @@ int main(int argc, char **argv) {
 	time.start();
 
 	while (!active->empty()) {
-		edgeMap(outGraph, active, WCC_F(ids, bins), no_output | prop_blocking);
-        bins->reset();
-		edgeMap(inGraph, active, WCC_F(ids, bins), no_output | prop_blocking);
+		edgeMap(outGraph, inGraph, active, WCC_F(ids, bins), no_output | prop_blocking);
         bins->reset();
 		Worklist<VID>* output = vertexFilter(outGraph, WCC_Shortcut(ids, prev_ids));
 		delete active;
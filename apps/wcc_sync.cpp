@@ -37,13 +37,13 @@ inline bool writeMin(T *a, T b) {
 	return r;
 }
 
-struct WCC_F : public EDGEMAP_F<uint32_t> {
-	Array<uint32_t>& ids;
+struct WCC_F : public EDGEMAP_F<VID> {
+	Array<VID>& ids;
 
-	WCC_F(Array<uint32_t>& i): ids(i) {}
+	WCC_F(Array<VID>& i): ids(i) {}
 
 	inline bool update(VID src, VID dst) {
-		uint32_t orig_id = ids[dst];
+		VID orig_id = ids[dst];
 		if (ids[src] < orig_id) {
 			ids[dst] = std::min(orig_id, ids[src]);
 		}
@@ -51,7 +51,7 @@ struct WCC_F : public EDGEMAP_F<uint32_t> {
 	}
 
 	inline bool updateAtomic(VID src, VID dst) {
-		uint32_t orig_id = ids[dst];
+		VID orig_id = ids[dst];
 		writeMin(&ids[dst], ids[src]);
 		return 1;
 	}
@@ -62,13 +62,13 @@ struct WCC_F : public EDGEMAP_F<uint32_t> {
 };
 
 struct WCC_Shortcut {
-	Array<uint32_t>& ids;
-	Array<uint32_t>& prev_ids;
+	Array<VID>& ids;
+	Array<VID>& prev_ids;
 
-	WCC_Shortcut(Array<uint32_t>& i, Array<uint32_t>& p): ids(i), prev_ids(p) {}
+	WCC_Shortcut(Array<VID>& i, Array<VID>& p): ids(i), prev_ids(p) {}
 
 	inline bool operator() (const VID& node) {
-		uint32_t l = ids[ids[node]];
+		VID l = ids[ids[node]];
 		if (ids[node] != l)
 			ids[node] = l;
 
@@ -83,8 +83,8 @@ struct WCC_Shortcut {
 };
 
 int main(int argc, char **argv) {
-	AgileStart(argc, argv);
-	Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB);
+	AgileStart(argc, argv, &inIndexFilename);
+	Runtime runtime(numComputeThreads, numIoThreads, ioBufferSize * MB, runtimeConfig);
 
 	Graph outGraph;
 	outGraph.BuildGraph(outIndexFilename, outAdjFilenames);
@@ -94,8 +94,8 @@ int main(int argc, char **argv) {
 
 	uint64_t n = outGraph.NumberOfNodes();
 
-	Array<uint32_t> ids;
-	Array<uint32_t> prev_ids;
+	Array<VID> ids;
+	Array<VID> prev_ids;
 	ids.allocate(n);
 	prev_ids.allocate(n);
 
@@ -112,8 +112,7 @@ int main(int argc, char **argv) {
 	time.start();
 
 	while (!active->empty()) {
-		edgeMap(outGraph, active, WCC_F(ids), no_output);
-		edgeMap(inGraph, active, WCC_F(ids), no_output);
+		edgeMap(outGraph, inGraph, active, WCC_F(ids), no_output);
 		Worklist<VID>* output = vertexFilter(outGraph, WCC_Shortcut(ids, prev_ids));
 		delete active;
 		active = output;
@@ -3,6 +3,7 @@
 
 #include "galois/ParallelSTL.h"
 #include "mem.h"
+#include "Numa.h"
 
 namespace blaze {
 
@@ -32,10 +33,18 @@ public:
 
 public:
     void allocate(size_type n) {
+        allocate(n, arrayPlacement);
+    }
+
+    // Pages are only touched for reading here, so the policy decides
+    // where they land on first write
+    void allocate(size_type n, NumaPlacement placement) {
         assert(!m_data);
         m_size = n;
         m_realdata = largeMalloc(n * sizeof(T), OnPmem);
         m_data = reinterpret_cast<T*>(m_realdata.get());
+        if (!OnPmem && n)
+            numaPlace(m_data, roundUp(n * sizeof(T), PAGE_SIZE), placement);
     }
 
     void deallocate() {
@@ -33,8 +33,8 @@ static int io_destroy(aio_context_t ctx) {
 class AsyncIoWorker {
  public:
     AsyncIoWorker(int fd, aio_context_t& ctx, PageReadList& read_list)
-        : _fd(fd), _ctx(ctx),
-            _read_list(read_list),
+        : _fd(fd), _read_list(read_list),
+            _ctx(ctx),
             _queued(0), _sent(0), _received(0),
             _total_bytes_accessed(0)
     {
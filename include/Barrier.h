@@ -10,6 +10,12 @@ class Barrier {
 
     ~Barrier() {}
 
+    // Only while nobody waits
+    void reset() {
+        std::lock_guard<std::mutex> guard(_cv_m);
+        _ready = false;
+    }
+
     void notify_all() {
         {
             std::lock_guard<std::mutex> guard(_cv_m);
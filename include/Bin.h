@@ -10,6 +10,8 @@
 #include "Type.h"
 #include "atomics.h"
 #include "Param.h"
+#include "Wait.h"
+#include "Numa.h"
 #include "blockingconcurrentqueue.h"
 #include "concurrentqueue.h"
 
@@ -21,15 +23,72 @@ namespace blaze {
 
 union converter { uint32_t i; float f; };
 
+/*
+ * A binned update: its destination and the bits of its value. With 32-bit
+ * vertex ids both share one word; wider ids take two.
+ */
+template <typename V>
+struct BinEntryOf {
+    V           _dst;
+    uint64_t    _value;
+
+    template <typename T>
+    static BinEntryOf make(V dst, T value) {
+        static_assert(sizeof(T) <= sizeof(uint64_t), "Bin values take up to 8 bytes");
+        BinEntryOf entry = { dst, 0 };
+        memcpy(&entry._value, &value, sizeof(T));
+        return entry;
+    }
+
+    V dst() const {
+        return _dst;
+    }
+
+    template <typename T>
+    T value() const {
+        T value;
+        memcpy(&value, &_value, sizeof(T));
+        return value;
+    }
+};
+
+template <>
+struct BinEntryOf<uint32_t> {
+    uint64_t    _word;      // dst in the high half
+
+    template <typename T>
+    static BinEntryOf make(uint32_t dst, T value) {
+        static_assert(sizeof(T) <= sizeof(uint32_t), "Bin values take up to 4 bytes with 32-bit vertex ids");
+        uint32_t bits = 0;
+        memcpy(&bits, &value, sizeof(T));
+        return { ((uint64_t)dst << 32) | bits };
+    }
+
+    uint32_t dst() const {
+        return _word >> 32;
+    }
+
+    template <typename T>
+    T value() const {
+        uint32_t bits = (uint32_t)_word;
+        T value;
+        memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+};
+
+using BinEntry = BinEntryOf<VID>;
+
 struct Bin {
     int             _id;
-    uint64_t        _size;
-    uint64_t*       _bin;
+    uint64_t        _size;      // entries
+    BinEntry*       _bin;
     int             _idx;
     atomic<int>     _state; // 0: binning, 1: accumulate
+    Parking*        _released;
 
-    Bin(int id, uint64_t size): _id(id), _size(size) {
-        size_t alloc_bin_size = ALIGN_UPTO(_size * 8, PAGE_SIZE);
+    Bin(int id, uint64_t size, Parking* released): _id(id), _size(size), _released(released) {
+        size_t alloc_bin_size = ALIGN_UPTO(_size * sizeof(BinEntry), PAGE_SIZE);
         int ret = posix_memalign((void **)&_bin, PAGE_SIZE, alloc_bin_size);
         assert(ret == 0);
         memset(_bin, 0, alloc_bin_size);
@@ -64,9 +123,10 @@ struct Bin {
     void reset() {
         make_empty();
         mark_binning();
+        _released->notify_all();
     }
 
-    uint64_t* get_bin() const {
+    BinEntry* get_bin() const {
         return _bin;
     }
 
@@ -86,13 +146,15 @@ struct Bin {
 
 struct FullBins {
     moodycamel::ConcurrentQueue<Bin*> _queue;
+    Parking*        _pushed;    // gather workers wait for full bins
 
-    FullBins() {}
+    FullBins(Parking* pushed): _pushed(pushed) {}
 
     ~FullBins() {}
 
     void push(Bin *bin) {
         _queue.enqueue(bin);
+        _pushed->notify_all();
     }
 
     Bin* pop() {
@@ -111,11 +173,13 @@ struct BinPair {
     mutex           _lock;
     FullBins*       _full_bins;
 
-    BinPair(int id, uint64_t size, FullBins* fbins)
-        : _id(id), _active(0), _full_bins(fbins)
+    Parking*        _released;  // scatter workers wait for gathered bins
+
+    BinPair(int id, uint64_t size, FullBins* fbins, Parking* released)
+        : _id(id), _active(0), _full_bins(fbins), _released(released)
     {
-        _pair[0] = new Bin(id, size / 2);
-        _pair[1] = new Bin(id, size / 2);
+        _pair[0] = new Bin(id, size / 2, released);
+        _pair[1] = new Bin(id, size / 2, released);
     }
 
     ~BinPair() {
@@ -141,7 +205,10 @@ struct BinPair {
         Bin *otherbin = _pair[other];
 
         // wait until the other bin is available
-        while (otherbin->is_accumulate()) {}
+        Waiter waiter(WAIT_BIN_SWITCH, _released);
+        while (otherbin->is_accumulate()) {
+            waiter.wait();
+        }
 
         // send my bin to accumulator
         mybin->mark_accumulate();
@@ -176,11 +243,11 @@ struct BinPair {
         *tail = cur_tail;
     }
 
-    bool append(uint64_t *src, int count) {
+    bool append(BinEntry *src, int count) {
         int active, tail;
         get_tail(count, &active, &tail);
-        uint64_t *dst = _pair[active]->_bin + tail;
-        memcpy(dst, src, count * 8);
+        BinEntry *dst = _pair[active]->_bin + tail;
+        memcpy(dst, src, count * sizeof(BinEntry));
 
         return true;
     }
@@ -200,6 +267,14 @@ struct BinPair {
         _pair[1]->reset();
         atomic_store(&_active, 0);
     }
+
+    // Move both bins to node and hand them to that node's gather workers
+    void place(int node, FullBins* fbins) {
+        for (int i = 0; i < 2; i++) {
+            numaBindToNode(_pair[i]->_bin, ALIGN_UPTO(_pair[i]->_size * sizeof(BinEntry), PAGE_SIZE), node, true);
+        }
+        _full_bins = fbins;
+    }
 };
 
 // multiple bins
@@ -209,13 +284,17 @@ struct Bins {
     int                 _bin_count;
     int                 _bin_buf_size;
     float               _binning_ratio;
-    uint64_t            _bin_size;
+    uint64_t            _bin_size;      // entries
     int                 _bin_shift;
     // data structures
-    uint64_t**          _buf;
+    BinEntry**          _buf;
     int**               _buf_idx;
     struct BinPair**    _bin_pairs;
-    FullBins            _full_bins;
+    // one queue of full bins per NUMA node of gather workers
+    std::vector<FullBins*>  _full_bins;
+    Parking             _pushed;
+    Parking             _released;
+    bool                _placed;
 
     template <typename Gr>
     Bins(Gr& graph, unsigned nthreads, uint64_t bins_size,
@@ -223,8 +302,10 @@ struct Bins {
     :   _nthreads(nthreads),
         _bin_count(bin_count),
         _bin_buf_size(bin_buf_size),
-        _binning_ratio(binning_ratio)
+        _binning_ratio(binning_ratio),
+        _placed(false)
     {
+        _full_bins.push_back(new FullBins(&_pushed));
         uint64_t n = graph.NumberOfNodes();
         init_buffer();
         init_bin(n - 1, bins_size);
@@ -234,13 +315,16 @@ struct Bins {
     ~Bins() {
         deinit_buffer();
         deinit_bin();
+        for (auto fbins : _full_bins) {
+            delete fbins;
+        }
     }
 
     void init_buffer() {
         int ret;
-        int buf_size = ALIGN_UPTO(_bin_count * _bin_buf_size * 8, PAGE_SIZE);
+        int buf_size = ALIGN_UPTO(_bin_count * _bin_buf_size * sizeof(BinEntry), PAGE_SIZE);
 
-        _buf = new uint64_t * [_nthreads];
+        _buf = new BinEntry * [_nthreads];
         _buf_idx = new int * [_nthreads];
 
         for (unsigned i = 0; i < _nthreads; i++) {
@@ -263,17 +347,17 @@ struct Bins {
     }
 
     void init_bin(uint64_t max_num, uint64_t size) {
-        _bin_size = size / _bin_count / 8;
+        _bin_size = size / _bin_count / sizeof(BinEntry);
 
         _bin_pairs = new BinPair * [_bin_count];
         for (int i = 0; i < _bin_count; i++) {
-            _bin_pairs[i] = new BinPair(i, _bin_size, &_full_bins);
+            _bin_pairs[i] = new BinPair(i, _bin_size, _full_bins[0], &_released);
         }
 
         // calculate shift size for binning
         uint64_t tmp = max_num;
         int msb = 0;
-        while (msb < 32) {
+        while (msb < (int)sizeof(VID) * 8) {
             if (tmp == 0) break;
             tmp >>= 1;
             msb++;
@@ -290,27 +374,67 @@ struct Bins {
     }
 
     void print() {
-        printf("bin width: %u kB\n", (1U << (_bin_shift - 10)));
+        printf("bin width: %lu kB\n", (1UL << _bin_shift) >> 10);
         printf("bin size: %lu MB = %d * %lu kB bins\n",
-                (_bin_size * _bin_count * 8) >> 20,
+                (_bin_size * _bin_count * sizeof(BinEntry)) >> 20,
                 _bin_count,
-                (_bin_size * 8) >> 10);
-        size_t buf_size = ALIGN_UPTO(_bin_count * _bin_buf_size * 8, PAGE_SIZE);
+                (_bin_size * sizeof(BinEntry)) >> 10);
+        size_t buf_size = ALIGN_UPTO(_bin_count * _bin_buf_size * sizeof(BinEntry), PAGE_SIZE);
         printf("buffer size: %lu KB\n", (buf_size * _nthreads) >> 10);
     }
 
-    Bin* get_full_bin() {
-        return _full_bins.pop();
+    // Full bins of node first, then of other nodes
+    Bin* get_full_bin(int node = 0) {
+        int num_queues = _full_bins.size();
+        for (int i = 0; i < num_queues; i++) {
+            Bin* bin = _full_bins[(node + i) % num_queues]->pop();
+            if (bin) return bin;
+        }
+        return nullptr;
+    }
+
+    Parking& get_full_bins_parking() {
+        return _pushed;
+    }
+
+    // wake gather workers parked on an empty queue
+    void notify_gather() {
+        _pushed.notify_all();
+    }
+
+    /*
+     * NUMA placement, done once before the first round: bin pair i goes to
+     * the node of gather worker i % G and scatter buffer i to the node of
+     * scatter worker i. Full bins are queued per node.
+     */
+    void place(const std::vector<int>& scatter_nodes, const std::vector<int>& gather_nodes) {
+        if (_placed || gather_nodes.empty()) return;
+        _placed = true;
+
+        int num_nodes = NumaTopology::get().getNumNodes();
+        for (int i = 1; i < num_nodes; i++) {
+            _full_bins.push_back(new FullBins(&_pushed));
+        }
+
+        for (int i = 0; i < _bin_count; i++) {
+            int node = gather_nodes[i % gather_nodes.size()];
+            _bin_pairs[i]->place(node, _full_bins[node]);
+        }
+
+        size_t buf_size = ALIGN_UPTO(_bin_count * _bin_buf_size * sizeof(BinEntry), PAGE_SIZE);
+        for (size_t i = 0; i < scatter_nodes.size() && i < _nthreads; i++) {
+            numaBindToNode(_buf[i], buf_size, scatter_nodes[i], true);
+        }
     }
 
     template <typename T>
     inline __attribute__((always_inline))
-    void append(unsigned tid, uint32_t x1, T x2) {
+    void append(unsigned tid, VID x1, T x2) {
         // calculate bin index
         int bid = x1 >> _bin_shift;
 
         // get the current buffer
-        uint64_t * const cur_buf = _buf[tid] + bid * _bin_buf_size;
+        BinEntry * const cur_buf = _buf[tid] + bid * _bin_buf_size;
         int buf_idx = _buf_idx[tid][bid];
 
         // flush the buffer if full
@@ -322,8 +446,7 @@ struct Bins {
         }
 
         // insert entry
-        uint64_t entry = ((uint64_t)x1 << 32) + *(uint32_t *)&x2;
-        cur_buf[buf_idx++] = entry;
+        cur_buf[buf_idx++] = BinEntry::make(x1, x2);
 
         // increment the buffer index
         _buf_idx[tid][bid] = buf_idx;
@@ -332,7 +455,7 @@ struct Bins {
     inline __attribute__((always_inline))
     void flush(unsigned tid) {
         for (int bid = 0; bid < _bin_count; bid++) {
-            uint64_t * const cur_buf = _buf[tid] + bid * _bin_buf_size;
+            BinEntry * const cur_buf = _buf[tid] + bid * _bin_buf_size;
             int buf_idx = _buf_idx[tid][bid];
             if (buf_idx > 0)
                 _bin_pairs[bid]->append(cur_buf, buf_idx);
@@ -371,7 +494,7 @@ struct Bins {
     }
 
     void prefetch_bin(char *base, int bid) {
-        uint32_t bin_width = 1U << _bin_shift;
+        uint64_t bin_width = 1UL << _bin_shift;
         char *beg = base + bid * bin_width;
         //printf("prefetch: base: %p, bin: %d, width: %u, range: [%p, %p]\n",
         //        base, bid, bin_width, beg, beg + bin_width);
@@ -53,12 +53,14 @@ class Bitmap {
 
     void set_all() {
         std::fill(start_, end_, 0xffffffffffffffff);
+        clear_tail();
     }
 
     void set_all_parallel() {
         galois::do_all(galois::iterate(iterator(0), iterator(num_words_)),
                        [&](uint64_t word) { start_[word] = 0xffffffffffffffff; },
                        galois::no_stats());
+        clear_tail();
     }
 
     void set_bit(size_t pos) {
@@ -185,6 +187,12 @@ class Bitmap {
     static size_t pos_in_next_word(uint64_t pos) { return ((pos >> 6) + 1) << 6; }
 
  private:
+    // no bits past size_, which would be vertices past the last one
+    void clear_tail() {
+        if (bit_offset(size_))
+            start_[num_words_ - 1] &= ((uint64_t)1 << bit_offset(size_)) - 1;
+    }
+
     uint64_t*   start_;
     uint64_t*   end_;
     uint64_t    num_words_;
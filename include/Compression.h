@@ -0,0 +1,235 @@
+#ifndef BLAZE_COMPRESSION_H
+#define BLAZE_COMPRESSION_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <functional>
+#include <immintrin.h>
+#include "Type.h"
+#include "Util.h"
+
+namespace blaze {
+
+/*
+ * Compressed edge blocks (convert -compress)
+ *
+ * The sorted neighbors of a vertex are delta coded in groups of four:
+ * a tag byte with the length (1 to 4 bytes) of each delta in two bits,
+ * then the deltas. A group never crosses a block; a vertex that does not
+ * fit continues after the header of the next block, and its first
+ * neighbor there is coded from 0 again, so every block decodes on its own.
+ *
+ * Each block starts with a CompressedBlockHeader telling how many edges of
+ * the vertices at its ends lie in it. The byte extent of a vertex runs up
+ * to the extent of the next one and includes the padding at block ends.
+ * Vertex ids are 32 bits (no BLAZE_VID64).
+ */
+struct CompressedBlockHeader {
+    uint32_t    first_skip;     // edges of the first vertex in earlier blocks
+    uint32_t    last_count;     // edges in this block of a vertex that goes on
+};
+
+class GroupVarint {
+ public:
+    // tag and four 4-byte deltas; a group starts only where this much is
+    // left in the block, so the decoder may load it whole
+    static constexpr uint32_t MAX_GROUP_SIZE = 17;
+
+    // Code n <= 4 sorted values after prev; returns the end of the group
+    static uint8_t* encodeGroup(uint8_t* out, const VID* values, int n, VID prev) {
+        uint8_t* tag = out++;
+        *tag = 0;
+        for (int k = 0; k < n; k++) {
+            uint32_t delta = values[k] - prev;
+            prev = values[k];
+            int len = delta < (1u << 8) ? 1 : delta < (1u << 16) ? 2 : delta < (1u << 24) ? 3 : 4;
+            memcpy(out, &delta, len);
+            out += len;
+            *tag |= (len - 1) << (2 * k);
+        }
+        return out;
+    }
+
+    // Bytes of the groups coding n sorted values
+    static uint64_t encodedSize(const VID* values, uint32_t n) {
+        uint64_t size = (n + 3) / 4;
+        VID prev = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t delta = values[i] - prev;
+            size += delta < (1u << 8) ? 1 : delta < (1u << 16) ? 2 : delta < (1u << 24) ? 3 : 4;
+            prev = values[i];
+        }
+        return size;
+    }
+
+    // Call f(dst) for count values coded from p on
+    template <typename F>
+    static void decode(const uint8_t* p, uint32_t count, F&& f) {
+        VID prev = 0;
+#ifdef __SSSE3__
+        const Table& table = getTable();
+        alignas(16) uint32_t values[4];
+        while (count) {
+            uint8_t tag = *p;
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 1)),
+                                         _mm_load_si128((const __m128i*)table.shuffle[tag]));
+            // prefix sum of the deltas
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, _mm_set1_epi32(prev));
+            _mm_store_si128((__m128i*)values, v);
+            uint32_t n = count < 4 ? count : 4;
+            for (uint32_t k = 0; k < n; k++) {
+                f(values[k]);
+            }
+            prev = values[3];
+            p += 1 + table.length[tag];
+            count -= n;
+        }
+#else
+        while (count) {
+            uint8_t tag = *p++;
+            uint32_t n = count < 4 ? count : 4;
+            for (uint32_t k = 0; k < n; k++) {
+                int len = ((tag >> (2 * k)) & 3) + 1;
+                uint32_t delta = 0;
+                memcpy(&delta, p, len);
+                p += len;
+                prev += delta;
+                f(prev);
+            }
+            count -= n;
+        }
+#endif
+    }
+
+ private:
+    // pshufb masks spreading the deltas of a tag over four 32-bit lanes
+    struct Table {
+        alignas(16) uint8_t shuffle[256][16];
+        uint8_t             length[256];
+
+        Table() {
+            for (int tag = 0; tag < 256; tag++) {
+                int pos = 0;
+                for (int k = 0; k < 4; k++) {
+                    int len = ((tag >> (2 * k)) & 3) + 1;
+                    for (int j = 0; j < 4; j++) {
+                        shuffle[tag][k * 4 + j] = j < len ? pos + j : 0x80;
+                    }
+                    pos += len;
+                }
+                length[tag] = pos;
+            }
+        }
+    };
+
+    static const Table& getTable() {
+        static const Table table;
+        return table;
+    }
+};
+
+/*
+ * Lays out the compressed edges of consecutive vertices in blocks and
+ * hands each full block to write_block.
+ */
+class CompressedEdgeWriter {
+ public:
+    CompressedEdgeWriter(uint32_t block_size, std::function<void(const char*)> write_block)
+        :   _block_size(block_size),
+            _write_block(write_block),
+            _block(block_size),
+            _num_blocks(0),
+            _pos(sizeof(CompressedBlockHeader))
+    {
+        memset(_block.data(), 0, block_size);
+    }
+
+    // Code the sorted neighbors of the next vertex; returns where its
+    // extent starts
+    uint64_t addVertex(const VID* edges, uint32_t degree) {
+        if (degree && room() < GroupVarint::MAX_GROUP_SIZE)
+            nextBlock();
+        uint64_t start = position();
+
+        uint32_t in_block = 0;
+        VID prev = 0;
+        for (uint32_t i = 0; i < degree; i += 4) {
+            if (room() < GroupVarint::MAX_GROUP_SIZE) {
+                header()->last_count = in_block;
+                nextBlock();
+                header()->first_skip = i;
+                in_block = 0;
+                prev = 0;
+            }
+            int n = std::min(degree - i, 4u);
+            uint8_t* out = (uint8_t*)_block.data() + _pos;
+            _pos += GroupVarint::encodeGroup(out, edges + i, n, prev) - out;
+            prev = edges[i + n - 1];
+            in_block += n;
+        }
+        return start;
+    }
+
+    // Write the last block; returns the end of the last extent
+    uint64_t finish() {
+        uint64_t end = position();
+        if (_pos > sizeof(CompressedBlockHeader))
+            nextBlock();
+        return end;
+    }
+
+    // Start the next vertex on a fresh block
+    void alignBlock() {
+        if (_pos > sizeof(CompressedBlockHeader))
+            nextBlock();
+    }
+
+    // Bytes left for edges in the current block, and in a fresh one
+    uint32_t getRoom() const {
+        return room();
+    }
+
+    uint32_t getCapacity() const {
+        return _block_size - sizeof(CompressedBlockHeader);
+    }
+
+    uint64_t getNumBlocks() const {
+        return _num_blocks;
+    }
+
+ private:
+    // a vertex starting on a fresh block starts before its header
+    uint64_t position() const {
+        uint64_t base = _num_blocks * _block_size;
+        return _pos == sizeof(CompressedBlockHeader) ? base : base + _pos;
+    }
+
+    uint32_t room() const {
+        return _block_size - _pos;
+    }
+
+    CompressedBlockHeader* header() {
+        return (CompressedBlockHeader*)_block.data();
+    }
+
+    void nextBlock() {
+        _write_block(_block.data());
+        _num_blocks++;
+        memset(_block.data(), 0, _block_size);
+        _pos = sizeof(CompressedBlockHeader);
+    }
+
+ private:
+    uint32_t                            _block_size;
+    std::function<void(const char*)>    _write_block;
+    std::vector<char>                   _block;
+    uint64_t                            _num_blocks;
+    uint32_t                            _pos;       // in the current block
+};
+
+} // namespace blaze
+
+#endif // BLAZE_COMPRESSION_H
@@ -7,6 +7,7 @@
 #include "ComputeWorker.h"
 #include "Synchronization.h"
 #include "Queue.h"
+#include "WorkerPool.h"
 
 namespace blaze {
 
@@ -14,14 +15,15 @@ class ComputeEngine {
  public:
     ComputeEngine(int start_tid,
                   int num_compute_workers,
-                  std::vector<MPMCQueue<IoItem*>*>& fetched_pages)
+                  std::vector<MPMCQueue<IoItem*>*>& fetched_pages,
+                  WorkerPool& thread_pool)
         :   _start_tid(start_tid),
             _in_frontier(nullptr),
             _out_frontier(nullptr),
-            _thread_pool(galois::substrate::getThreadPool())
+            _thread_pool(thread_pool)
     {
         for (int i = 0; i < num_compute_workers; i++) {
-            _workers.push_back(new ComputeWorker(i, fetched_pages));
+            _workers.push_back(new ComputeWorker(i, num_compute_workers, fetched_pages));
         }
     }
 
@@ -49,20 +51,22 @@ class ComputeEngine {
         }
     }
 
+    // With a MemScheduler workers take pages from memory instead of IO;
+    // with in_graph they take the pages of both graphs of a fused edgeMap
     template <typename Gr, typename Func>
-    void start(Gr& graph, Func& func, Synchronization& sync) {
+    void start(Gr& graph, Func& func, Synchronization& sync, MemScheduler* mem = nullptr,
+               Gr* in_graph = nullptr) {
         _time_start = std::chrono::steady_clock::now();
 
-        std::vector<std::function<void(void)>> functions;
-        for (auto worker : _workers) {
-            std::function<void(void)> f = std::bind(&ComputeWorker::run<Gr, Func>,
-                                                    worker,
-                                                    std::ref(graph),
-                                                    std::ref(func),
-                                                    std::ref(sync));
-            functions.push_back(f);
-        }
-        _thread_pool.fork(_start_tid, _workers.size(), functions); // run compute workers after 2 * io workers to avoid interference
+        ComputeWorker** workers = _workers.data();
+        if (mem)
+            _thread_pool.fork(_start_tid, _workers.size(), [workers, &graph, &func, mem](int i) {
+                workers[i]->runInMemory(graph, func, *mem);
+            });
+        else
+            _thread_pool.fork(_start_tid, _workers.size(), [workers, &graph, &func, &sync, in_graph](int i) {
+                workers[i]->run(graph, func, sync, in_graph);
+            });
     }
 
     template <typename Gr>
@@ -75,6 +79,18 @@ class ComputeEngine {
         return duration.count();
     }
 
+    int getNumberOfWorkers() const {
+        return _workers.size();
+    }
+
+    uint64_t getNumSteals() const {
+        uint64_t steals = 0;
+        for (auto worker : _workers) {
+            steals += worker->getNumSteals();
+        }
+        return steals;
+    }
+
     Worklist<VID>* getOutFrontier() {
         return _out_frontier;
     }
@@ -85,7 +101,7 @@ class ComputeEngine {
     Worklist<VID>*                          _in_frontier;
     std::vector<Bitmap*>                    _out_frontiers;
     Worklist<VID>*                          _out_frontier;
-    galois::substrate::ThreadPool&          _thread_pool;
+    WorkerPool&                             _thread_pool;
     std::chrono::time_point<std::chrono::steady_clock>  _time_start;
     std::chrono::time_point<std::chrono::steady_clock>  _time_end;
 };
@@ -5,7 +5,10 @@
 #include "Type.h"
 #include "galois/Bag.h"
 #include "Synchronization.h"
+#include "IoBufferPool.h"
+#include "MemScheduler.h"
 #include "Queue.h"
+#include "Wait.h"
 #include "Param.h"
 
 namespace blaze {
@@ -13,14 +16,17 @@ namespace blaze {
 class ComputeWorker {
  public:
     ComputeWorker(int id,
+                  int num_workers,
                   std::vector<MPMCQueue<IoItem*>*>& fetched_pages)
         :   _id(id),
-            _num_disks(0),
+            _num_workers(num_workers),
             _fetched_pages(fetched_pages),
             _in_frontier(nullptr),
             _out_frontier(nullptr),
             _time(0.0),
-            _num_processed_pages(0)
+            _num_processed_pages(0),
+            _num_steals(0),
+            _seed(id * 2654435761u + 1)
     {}
 
     ~ComputeWorker() {}
@@ -30,31 +36,51 @@ class ComputeWorker {
         _out_frontier = out;
     }
 
+    // Pages tagged 1 belong to in_graph (fused edgeMap)
     template <typename Gr, typename Func>
-    void run(Gr& graph, Func& func, Synchronization& sync) {
-        _num_disks = graph.NumberOfDisks();
-        _p2v_map = &graph.GetP2VMap();
-
+    void run(Gr& graph, Func& func, Synchronization& sync, Gr* in_graph = nullptr) {
         sync.wait_io_start();
 
+        auto queues = assignQueues(_id, _num_workers, _fetched_pages);
+        _num_steals = 0;
+
         IoItem *items[IO_PAGE_QUEUE_BULK_DEQ];
-        size_t count;
+        size_t count, total;
         bool io_done = false;
 
+        Waiter waiter(WAIT_FETCHED_PAGES, &sync.fetched_pages());
+
         while (1) {
             do {
-                count = _fetched_pages[_id % _num_disks]->try_dequeue_bulk(items, IO_PAGE_QUEUE_BULK_DEQ);
-                for (size_t i = 0; i < count; i++) {
-                    processFetchedPages(graph, func, *items[i], sync);
-                    delete items[i];
+                total = 0;
+                for (auto queue : queues) {
+                    count = queue->try_dequeue_bulk(items, IO_PAGE_QUEUE_BULK_DEQ);
+                    for (size_t i = 0; i < count; i++) {
+                        processFetchedPages(items[i]->graph ? *in_graph : graph, func, *items[i], sync);
+                    }
+                    total += count;
                 }
-            } while (count > 0);
+
+                // own queues are empty: steal from other workers
+                if (!total) {
+                    count = stealQueues(_fetched_pages, queues, items, IO_PAGE_QUEUE_STEAL_DEQ, _seed);
+                    for (size_t i = 0; i < count; i++) {
+                        processFetchedPages(items[i]->graph ? *in_graph : graph, func, *items[i], sync);
+                    }
+                    _num_steals += count;
+                    total += count;
+                }
+
+                if (total) waiter.done();
+            } while (total > 0);
 
             if (sync.check_io_done()) {
                 // All completed IOs are sent and placed in the ring buffer.
                 // One more loop is required to process them.
                 if (!io_done) io_done = true;
                 else                    break;
+            } else {
+                waiter.wait();
             }
         }
 
@@ -62,85 +88,100 @@ class ComputeWorker {
         _out_frontier = nullptr;
     }
 
+    // In-memory mode: take pages straight from the graph
+    template <typename Gr, typename Func>
+    void runInMemory(Gr& graph, Func& func, MemScheduler& scheduler) {
+        const int num_disks = graph.NumberOfDisks();
+
+        uint64_t beg, end;
+        while (scheduler.next(_id, &beg, &end)) {
+            scheduler.forEachPage(beg, end,
+                [&](int disk_id, PAGEID ppid) {
+                    processFetchedPage(graph, func, ppid * num_disks + disk_id,
+                                       graph.GetEdgePage(disk_id, ppid));
+                    _num_processed_pages++;
+                });
+        }
+
+        _in_frontier = nullptr;
+        _out_frontier = nullptr;
+    }
+
+    // IO items taken from other workers' queues in the last run
+    uint64_t getNumSteals() const {
+        return _num_steals;
+    }
+
  private:
     template <typename Gr, typename Func>
     void processFetchedPages(Gr& graph, Func& func, IoItem& item, Synchronization& sync) {
         PAGEID ppid_start = item.page;
         const PAGEID ppid_end = item.page + item.num;
         char* buffer = item.buf;
+        const int num_disks = graph.NumberOfDisks();
+        const uint32_t block_size = graph.GetBlockSize();
+        // pages read only to fill a gap are not in the page bitmap
+        Bitmap* page_bitmap = item.num_fillers ? graph.GetActivatedPages(item.disk_id) : nullptr;
         while (ppid_start < ppid_end) {
-            const PAGEID pid = ppid_start * _num_disks + item.disk_id;
-            processFetchedPage(graph, func, pid, buffer);
+            const PAGEID pid = ppid_start * num_disks + item.disk_id;
+            if (!page_bitmap || page_bitmap->get_bit(ppid_start))
+                processFetchedPage(graph, func, pid, buffer);
             ppid_start++;
-            buffer += PAGE_SIZE;
+            buffer += block_size;
         }
         _num_processed_pages += item.num;
-        free(item.buf);
-        sync.add_num_free_pages(item.disk_id, item.num);
+        item.pool->release(&item);
     }
 
     template <typename Gr, typename Func>
     void processFetchedPage(Gr& graph, Func& func, PAGEID pid, char* buffer) {
-        const VID vid_start = _p2v_map[pid].first;
-        const VID vid_end = _p2v_map[pid].second;
+        VidRange* p2v_map = &graph.GetP2VMap();
+        const uint32_t block_size = graph.GetBlockSize();
+        const VID vid_start = p2v_map[pid].first;
+        const VID vid_end = p2v_map[pid].second;
 
-        const uint64_t page_start = (uint64_t)pid * PAGE_SIZE;
-        const uint64_t page_end = page_start + PAGE_SIZE;
+        const uint64_t page_start = (uint64_t)pid * block_size;
 
+        // the edges of consecutive vertices follow each other
         VID vid = vid_start;
+        uint64_t offset = graph.GetByteOffset(vid);
         while (vid <= vid_end) {
-            applyFunction(graph, func, vid, page_start, page_end, buffer);
+            uint64_t offset_end = offset + graph.GetEdgeBytes(vid);
+            applyFunction(graph, func, vid, graph.GetDegree(vid), offset, offset_end, page_start, buffer);
+            offset = offset_end;
             vid++;
         }
     }
 
     template <typename Gr, typename Func>
-    bool applyFunction(Gr& graph, Func& func, const VID& vid, const uint64_t page_start, const uint64_t page_end, char *buffer) {
-        uint32_t degree = graph.GetDegree(vid);
+    bool applyFunction(Gr& graph, Func& func, const VID& vid, uint32_t degree, uint64_t offset,
+                       uint64_t offset_end, const uint64_t page_start, char *buffer) {
         if (!degree || (_in_frontier && !_in_frontier->activated(vid)))
             return false;
 
-        uint64_t offset = graph.GetOffset(vid) * sizeof(VID);
-        uint64_t offset_end = offset + (degree << EDGE_WIDTH_BITS);
-        uint32_t offset_in_buf;
-
-        if (offset < page_start) {
-            degree -= (page_start - offset) >> EDGE_WIDTH_BITS;
-            offset_in_buf = 0;
-
-        } else {
-            offset_in_buf = offset - page_start;
-        }
-
-        if (offset_end > page_end) {
-            degree -= (offset_end - page_end) >> EDGE_WIDTH_BITS;
-        }
-
-        VID* edges = (VID*)(buffer + offset_in_buf);
-        PAGEID pid, pid_end;
-
-        for (uint32_t i = 0; i < degree; i++) {
-            VID dst = edges[i];
-            if (func.cond(dst) && func.updateAtomic(vid, dst)) {
-                // activate
-                if (_out_frontier) {
-                    _out_frontier->activate(dst);
+        graph.ForEachEdgeInBlock(degree, offset, offset_end, page_start, buffer,
+            [&](VID dst, EDGEDATA data) {
+                if (func.cond(dst) && applyUpdateAtomic(func, vid, dst, data)) {
+                    // activate
+                    if (_out_frontier) {
+                        _out_frontier->activate(dst);
+                    }
                 }
-            }
-        }
+            });
 
         return true;
     }
 
  private:
     int                     _id;
-    int                     _num_disks;
-    VidRange*               _p2v_map;
+    int                     _num_workers;
     std::vector<MPMCQueue<IoItem*>*>&    _fetched_pages;
     Worklist<VID>*          _in_frontier;
     Worklist<VID>*          _out_frontier;
     double                  _time;
     uint64_t                _num_processed_pages;
+    uint64_t                _num_steals;
+    uint32_t                _seed;
 };
 
 } // namespace blaze
@@ -0,0 +1,80 @@
+#ifndef BLAZE_CONFIG_H
+#define BLAZE_CONFIG_H
+
+#include <cstdint>
+#include <vector>
+#include "Param.h"
+
+namespace blaze {
+
+enum IoBackend { IO_BACKEND_AIO, IO_BACKEND_URING };
+
+enum CachePolicy { CACHE_CLOCK, CACHE_LRU, CACHE_PIN };
+
+enum NumaPlacement { NUMA_LOCAL, NUMA_INTERLEAVED, NUMA_PARTITIONED };
+
+/*
+ * Runtime tunables that are not fixed at compile time.
+ * Filled from the command line by AgileStart() and handed to Runtime.
+ */
+struct Config {
+    // IO
+    IoBackend       io_backend;
+    bool            io_sqpoll;      // io_uring: kernel-side submission polling
+    bool            io_iopoll;      // io_uring: busy-poll completions (NVMe poll queues)
+    uint32_t        io_request_size;        // bytes, at least one edge block is read
+    uint32_t        io_queue_depth;
+    // dense mode reads through holes of up to this many unneeded pages;
+    // one entry for all devices or one entry per device
+    std::vector<uint32_t>   io_gap_pages;
+    // dense mode: build the page frontier while IO workers already read
+    bool            io_pipeline;
+    // read the pages of a dense round again ahead of the next round
+    bool            io_speculate;
+    // edgeMap on a sparse frontier whose edges span at most this many
+    // blocks runs on the calling thread; 0 disables
+    uint32_t        inline_max_pages;
+    // edge page cache, disabled when size is 0
+    uint64_t        cache_size;
+    CachePolicy     cache_policy;
+    // keep edge files in memory and run edgeMap without IO workers
+    bool            in_memory;
+    // per-round latency histograms and queue timelines (# IOSTAT lines)
+    bool            io_stats;
+    // pin workers per NUMA node, place IO buffers and bins near their users
+    bool            numa;
+    // placement of Array<T> allocations
+    NumaPlacement   array_placement;
+    // keep the edge offset of every vertex, 8 bytes per vertex
+    bool            full_offsets;
+
+    Config()
+        :   io_backend(IO_BACKEND_AIO),
+            io_sqpoll(false),
+            io_iopoll(false),
+            io_request_size(IO_REQ_SIZE),
+            io_queue_depth(IO_QUEUE_DEPTH),
+            io_pipeline(false),
+            io_speculate(false),
+            inline_max_pages(INLINE_MAX_PAGES),
+            cache_size(0),
+            cache_policy(CACHE_CLOCK),
+            in_memory(false),
+            io_stats(false),
+            numa(false),
+            array_placement(NUMA_LOCAL),
+            full_offsets(false)
+    {}
+
+    uint32_t getGapPages(int disk_id) const {
+        if (io_gap_pages.empty())
+            return 0;
+        if (io_gap_pages.size() == 1)
+            return io_gap_pages[0];
+        return disk_id < (int)io_gap_pages.size() ? io_gap_pages[disk_id] : 0;
+    }
+};
+
+} // namespace blaze
+
+#endif // BLAZE_CONFIG_H
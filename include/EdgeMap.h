@@ -2,6 +2,9 @@
 #define BLAZE_PARALLEL_FOR_H
 
 #include <vector>
+#include <array>
+#include <tuple>
+#include <chrono>
 #include <iomanip>
 #include <sstream>
 #include "galois/Galois.h"
@@ -10,6 +13,7 @@
 #include "IoEngine.h"
 #include "ComputeEngine.h"
 #include "PBEngine.h"
+#include "MemScheduler.h"
 #include "Synchronization.h"
 #include "VertexMap.h"
 #include "Queue.h"
@@ -22,32 +26,54 @@ enum FrontierType {
     EMPTY, DENSE_ALL, DENSE, SPARSE
 };
 
+// With in_graph, one round over the edges of both graphs (fused edgeMap)
 template <typename Gr, typename Func>
 class EdgeMapExecutor {
  public:
     EdgeMapExecutor(Gr& graph,
                     Worklist<VID>* frontier,
                     Func&& func,
-                    FLAGS flags)
+                    FLAGS flags,
+                    Gr* in_graph = nullptr)
         :   _runtime(Runtime::getRuntimeInstance()),
             _graph(graph),
+            _in_graph(in_graph),
             _out_frontier(nullptr),
             _fetched_tasks(nullptr),
             _io_engine(_runtime.getIoEngine()),
             _compute_engine(_runtime.getComputeEngine()),
             _pb_engine(_runtime.getPBEngine()),
+            _mem_scheduler(nullptr),
             _func(func),
             _flags(flags),
             _work_exists(true),
             _num_activated_nodes(0),
             _num_activated_edges(0),
             _frontier_type(EMPTY),
+            _inline(false),
+            _inline_io_bytes(0),
+            _inline_cached_bytes(0),
             _io_time(0.0), _compute_time(0.0)
     {
         _runtime.incRound();
 
+        if (_runtime.getConfig().in_memory)
+            _graph.LoadEdgesInMemory();
+
         uint64_t n = _graph.NumberOfNodes();
         uint64_t m = _graph.NumberOfEdges();
+        if (_in_graph)
+            m += _in_graph->NumberOfEdges();
+
+        // a handful of vertices: no workers, queues or page bitmaps
+        if (frontier && !_in_graph && planInline(frontier)) {
+            if (!_num_activated_edges) {
+                _work_exists = false;
+                _out_frontier = new Worklist<VID>(n);
+            }
+            return;
+        }
+
         _num_activated_edges = frontier ? getNumberOfActiveEdges(frontier) : m;
 
         // nothing to do
@@ -57,8 +83,10 @@ class EdgeMapExecutor {
             return;
         }
 
-        // filter out empty nodes
-        filterOutEmptyNodes(frontier);
+        // filter out empty nodes; in a fused round a vertex may have
+        // edges in one of the graphs only
+        if (!_in_graph)
+            filterOutEmptyNodes(frontier);
 
         _num_activated_nodes = frontier ? frontier->count() : n;
 
@@ -86,62 +114,116 @@ class EdgeMapExecutor {
         // build sparse page frontier in sparse case
         if (frontier) {
             if (frontier->is_dense()) {
-                buildDensePageFrontier(frontier);
+                // otherwise the IO engine builds it while reading
+                if (_graph.IsInMemory() || !_io_engine->pipelinesDenseFrontier() || _in_graph)
+                    buildDensePageFrontier(_graph, frontier);
             } else {
-                buildSparsePageFrontier(frontier);
+                buildSparsePageFrontier(_graph, frontier, _sparse_page_frontier);
             }
         } else {
-            buildDensePageFrontier(frontier);
+            buildDensePageFrontier(_graph, frontier);
+        }
+        if (_in_graph) {
+            if (frontier && !frontier->is_dense())
+                buildSparsePageFrontier(*_in_graph, frontier, _in_sparse_page_frontier);
+            else
+                buildDensePageFrontier(*_in_graph, frontier);
         }
 
         // set frontier for compute engine
 
-        if (use_prop_blocking(_flags))
+        if (usePropBlocking())
             _pb_engine->setFrontier(_graph, frontier, flags);
         else
             _compute_engine->setFrontier(_graph, frontier, flags);
 
-        _io_engine->setFrontier(frontier, _sparse_page_frontier);
+        if (_graph.IsInMemory()) {
+            int num_workers = usePropBlocking() ?
+                                _pb_engine->getNumberOfScatterWorkers() :
+                                _compute_engine->getNumberOfWorkers();
+            _mem_scheduler = new MemScheduler(num_workers);
+            _mem_scheduler->setFrontier(_graph, frontier == nullptr, _sparse_page_frontier);
+        } else {
+            _io_engine->setFrontier(frontier, _sparse_page_frontier,
+                                    _in_graph ? &_in_sparse_page_frontier : nullptr);
+            _io_engine->attachCache(_graph, _in_graph);
+        }
     }
 
     ~EdgeMapExecutor() {
         for (auto frontier : _sparse_page_frontier) {
             delete frontier;
         }
+        for (auto frontier : _in_sparse_page_frontier) {
+            delete frontier;
+        }
+        if (_mem_scheduler)
+            delete _mem_scheduler;
     }
 
     void run() {
         if (!_work_exists) return;
 
-        int num_disks = _graph.NumberOfDisks();
-        Synchronization sync(num_disks);
-        IoSync io_sync(num_disks);
+        if (_inline) {
+            runInline();
+            if (!_graph.IsInMemory()) {
+                _runtime.addAccessedIoBytes(_inline_io_bytes);
+                _runtime.addCachedBytes(_inline_cached_bytes);
+                for (size_t i = 0; i < _inline_device_bytes.size(); i++) {
+                    _runtime.addDeviceIoBytes(i, _inline_device_bytes[i]);
+                }
+                _runtime.addIoTime(_io_time);
+            }
+            _runtime.addAccessedEdges(_num_activated_edges);
+            print();
+            return;
+        }
 
-        if (use_prop_blocking(_flags)) {
-            _pb_engine->start(_graph, _func, sync);
-            _io_time = _io_engine->run(_graph, sync, io_sync);
-            _compute_time = _pb_engine->stop(_graph, _func, sync);
-            _out_frontier = _pb_engine->getOutFrontier();
+        int num_disks = _graph.NumberOfDisks();
+        if (_in_graph)
+            num_disks = std::max(num_disks, _in_graph->NumberOfDisks());
+        Synchronization& sync = _runtime.resetSynchronization();
+        IoSync& io_sync = _runtime.resetIoSync(num_disks);
+
+        if (usePropBlocking()) {
+            if constexpr (binnable) {
+                _pb_engine->start(_graph, _func, sync, _mem_scheduler, _in_graph);
+                runIo(sync, io_sync);
+                _compute_time = _pb_engine->stop(_graph, _func, sync);
+                _out_frontier = _pb_engine->getOutFrontier();
+            }
 
         } else {
-            _compute_engine->start(_graph, _func, sync);
-            _io_time = _io_engine->run(_graph, sync, io_sync);
+            _compute_engine->start(_graph, _func, sync, _mem_scheduler, _in_graph);
+            runIo(sync, io_sync);
             _compute_time = _compute_engine->stop(_graph);
             _out_frontier = _compute_engine->getOutFrontier();
         }
 
         _graph.ResetPageActivation();
+        if (_in_graph)
+            _in_graph->ResetPageActivation();
 
         if (_work_exists) {
-            uint64_t io_bytes = _io_engine->getTotalBytesAccessed();
-            _runtime.addAccessedIoBytes(io_bytes);
+            if (!_mem_scheduler) {
+                uint64_t io_bytes = _io_engine->getTotalBytesAccessed();
+                _runtime.addAccessedIoBytes(io_bytes);
+                for (int i = 0; i < _io_engine->getNumberOfDevices(); i++) {
+                    _runtime.addDeviceIoBytes(i, _io_engine->getDeviceBytesAccessed(i));
+                }
+                _runtime.addWastedIoBytes(_io_engine->getTotalBytesWasted());
+                _runtime.addCachedBytes(_io_engine->getTotalBytesCached());
+                _runtime.addSpeculatedBytes(_io_engine->getTotalBytesSpeculated(),
+                                            _io_engine->getTotalBytesSpeculatedUsed());
+                _runtime.addIoTime(_io_time);
+            }
             _runtime.addAccessedEdges(_num_activated_edges);
-            _runtime.addIoTime(_io_time);
         }
 
         print();
 
-        _io_engine->initState();
+        if (!_mem_scheduler)
+            _io_engine->initState();
     }
 
     Worklist<VID>* newFrontier() {
@@ -151,7 +233,9 @@ class EdgeMapExecutor {
     void print() {
         int round = _runtime.getRound();
         uint64_t io_bytes = 0;
-        if (_io_engine)
+        if (_inline)
+            io_bytes = _inline_io_bytes;
+        else if (!_mem_scheduler)
             io_bytes = _io_engine->getTotalBytesAccessed();
 
         // frontier type
@@ -170,6 +254,11 @@ class EdgeMapExecutor {
 
         std::cout << info;
 
+        if (_inline) {
+            std::cout << " (inline)" << std::endl;
+            return;
+        }
+
         if (_pb_engine) {
             double bin_skew = _pb_engine->getScatterSkewness();
             double acc_skew = _pb_engine->getGatherSkewness();
@@ -181,17 +270,203 @@ class EdgeMapExecutor {
             std::cout << ")";
         }
 
-        if (_io_engine) {
+        if (_mem_scheduler) {
+            std::cout << " (mem: " << _mem_scheduler->getNumSteals() << " steals)";
+
+        } else {
             double io_skew = _io_engine->getSkewness();
             std::cout << " (io: ";
-            std::cout << std::fixed << std::setprecision(2) << io_skew;
+            if (io_skew > 0.0)
+                std::cout << std::fixed << std::setprecision(2) << io_skew;
+            else
+                std::cout << "n/a";
             std::cout << ")";
+
+            uint64_t steals = usePropBlocking() ?
+                                _pb_engine->getNumSteals() :
+                                _compute_engine->getNumSteals();
+            std::cout << " (fetch: " << steals << " steals)";
+
+            uint64_t wasted_bytes = _io_engine->getTotalBytesWasted();
+            if (wasted_bytes)
+                std::cout << " (gap: " << wasted_bytes << " bytes)";
+
+            uint64_t spec_bytes = _io_engine->getTotalBytesSpeculated();
+            if (spec_bytes)
+                std::cout << " (spec: " << _io_engine->getTotalBytesSpeculatedUsed()
+                          << "/" << spec_bytes << " bytes used)";
         }
 
         std::cout << std::endl;
+
+        if (!_mem_scheduler && _io_engine->isCacheEnabled()) {
+            uint64_t cached_bytes = _io_engine->getTotalBytesCached();
+            uint64_t total_bytes = cached_bytes + io_bytes;
+            double hit_ratio = total_bytes ? (double)cached_bytes * 100.0 / total_bytes : 0.0;
+            printf("# PAGE CACHE  : Benefit %12lu bytes (%.2f%%) hit ratio, %12lu total bytes\n",
+                    cached_bytes, hit_ratio, total_bytes);
+        }
+
+        if (!_mem_scheduler && _io_engine->isStatsEnabled())
+            _io_engine->printIoStats(round);
     }
 
  private:
+    static constexpr bool binnable = has_bins<std::remove_reference_t<Func>>::value;
+
+    // A function without bins runs on the compute workers whatever the flags
+    bool usePropBlocking() const {
+        return binnable && use_prop_blocking(_flags);
+    }
+
+    // Without IO workers the gather side still waits for the start signal
+    void runIo(Synchronization& sync, IoSync& io_sync) {
+        if (_mem_scheduler) {
+            sync.notify_io_start();
+            sync.mark_io_done();
+        } else {
+            _io_time = _io_engine->run(_graph, sync, io_sync, _in_graph);
+        }
+    }
+
+    // A sparse frontier whose edges span at most inline_max_pages blocks is
+    // run by the calling thread. Counts and filters the frontier the way the
+    // parallel path does; returns false, with nothing changed, otherwise.
+    bool planInline(Worklist<VID>* frontier) {
+        uint32_t max_pages = _runtime.getConfig().inline_max_pages;
+        if (!max_pages || frontier->is_dense() || frontier->count() > max_pages)
+            return false;
+
+        CountableBag<VID>* nodes = frontier->get_sparse();
+        uint64_t num_nodes = 0, num_edges = 0, num_pages = 0;
+        bool has_empty = false;
+        for (VID vid : *nodes) {
+            uint32_t degree = _graph.GetDegree(vid);
+            if (!degree) {
+                has_empty = true;
+                continue;
+            }
+            PAGEID pid, pid_end;
+            _graph.GetPageRange(vid, &pid, &pid_end);
+            num_pages += pid_end - pid + 1;
+            if (num_pages > max_pages) {
+                _inline_blocks.clear();
+                return false;
+            }
+            while (pid <= pid_end) {
+                _inline_blocks.push_back(std::make_pair(pid++, vid));
+            }
+            num_nodes++;
+            num_edges += degree;
+        }
+
+        if (has_empty) {
+            auto new_sparse = new CountableBag<VID>();
+            for (VID vid : *nodes) {
+                if (_graph.GetDegree(vid) > 0)
+                    new_sparse->push(vid);
+            }
+            delete nodes;
+            frontier->set_sparse(new_sparse);
+        }
+
+        // by block, and a vertex listed twice is applied once
+        std::sort(_inline_blocks.begin(), _inline_blocks.end());
+        _inline_blocks.erase(std::unique(_inline_blocks.begin(), _inline_blocks.end()), _inline_blocks.end());
+
+        _num_activated_nodes = num_nodes;
+        _num_activated_edges = num_edges;
+        _frontier_type = SPARSE;
+        _inline = true;
+        return true;
+    }
+
+    // Read each block once, all at a time, and apply the function to its
+    // vertices as it arrives. Blocks in the page cache of an IO worker are
+    // taken from there.
+    void runInline() {
+        auto start = std::chrono::steady_clock::now();
+
+        if (should_output(_flags))
+            _out_frontier = new Worklist<VID>(_graph.NumberOfNodes());
+
+        uint32_t block_size = _graph.GetBlockSize();
+        std::vector<size_t> first;          // of each block in _inline_blocks
+        std::vector<InlineRead> reads;
+        std::vector<std::pair<size_t, const char*>> hits;  // first and cached copy
+        bool use_cache = !_graph.IsInMemory() && _io_engine->isCacheEnabled();
+        _inline_device_bytes.assign(_graph.NumberOfDisks(), 0);
+        _inline_cached_bytes = 0;
+        for (size_t i = 0; i < _inline_blocks.size(); i++) {
+            if (i && _inline_blocks[i].first == _inline_blocks[i - 1].first)
+                continue;
+            int disk_id;
+            PAGEID ppid;
+            _graph.GetPageLocation(_inline_blocks[i].first, &disk_id, &ppid);
+            int fd = _graph.IsInMemory() ? disk_id : _graph.GetEdgeFileDescriptor(disk_id);
+            const char* cached = use_cache ? _io_engine->findCachedPage(fd, ppid) : nullptr;
+            if (cached) {
+                hits.push_back(std::make_pair(i, cached));
+                _inline_cached_bytes += block_size;
+                continue;
+            }
+            first.push_back(i);
+            reads.push_back({ fd, ppid });
+            _inline_device_bytes[disk_id] += block_size;
+        }
+
+        auto apply = [&](size_t f, const char* buffer) {
+            PAGEID pid = _inline_blocks[f].first;
+            uint64_t page_start = (uint64_t)pid * block_size;
+            for (size_t i = f; i < _inline_blocks.size() && _inline_blocks[i].first == pid; i++) {
+                applyInline(_inline_blocks[i].second, page_start, buffer);
+            }
+        };
+        auto process = [&](size_t r, char* buffer) {
+            apply(first[r], buffer);
+        };
+
+        for (auto& hit : hits) {
+            apply(hit.first, hit.second);
+        }
+
+        if (_graph.IsInMemory()) {
+            for (size_t r = 0; r < reads.size(); r++) {
+                process(r, _graph.GetEdgePage(reads[r].fd, reads[r].ppid));
+            }
+            _inline_device_bytes.clear();
+        } else {
+            _runtime.getInlineReader()->read(reads, block_size, process);
+            _inline_io_bytes = (uint64_t)reads.size() * block_size;
+        }
+
+        std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        _io_time = _graph.IsInMemory() ? 0.0 : duration.count();
+        _compute_time = duration.count();
+    }
+
+    // The edges of vid within one block. With a single thread the gather of
+    // a binned update is applied at once.
+    void applyInline(VID vid, uint64_t page_start, const char* buffer) {
+        uint64_t offset = _graph.GetByteOffset(vid);
+        uint64_t offset_end = offset + _graph.GetEdgeBytes(vid);
+        bool binned = usePropBlocking();
+
+        _graph.ForEachEdgeInBlock(_graph.GetDegree(vid), offset, offset_end, page_start, buffer,
+            [&](VID dst, EDGEDATA data) {
+                if (!_func.cond(dst))
+                    return;
+                bool activated;
+                if constexpr (binnable)
+                    activated = binned ? _func.gather(dst, applyScatter(_func, vid, dst, data))
+                                       : applyUpdateAtomic(_func, vid, dst, data);
+                else
+                    activated = applyUpdateAtomic(_func, vid, dst, data);
+                if (activated && _out_frontier)
+                    _out_frontier->activate(dst);
+            });
+    }
+
     void filterOutEmptyNodes(Worklist<VID>* frontier) {
         if (!frontier)
             return;
@@ -218,49 +493,74 @@ class EdgeMapExecutor {
         vertexMap(frontier,
                 [&](const VID& node) {
                     active_edges += _graph.GetDegree(node);
+                    if (_in_graph)
+                        active_edges += _in_graph->GetDegree(node);
                 }); 
 
         return active_edges.reduce();
     }  
 
-    void buildSparsePageFrontier(Worklist<VID>* frontier) {
-        int num_disks = _graph.NumberOfDisks();
-        int num_disks_bit = (int)log2((float)num_disks);
+    void buildSparsePageFrontier(Gr& graph, Worklist<VID>* frontier, std::vector<PageList*>& page_frontier) {
+        int num_disks = graph.NumberOfDisks();
 
+        std::vector<CountableBag<PAGEID>*> page_bags;
         for (int i = 0; i < num_disks; i++) {
-            _sparse_page_frontier.push_back(new CountableBag<PAGEID>());
+            page_bags.push_back(new CountableBag<PAGEID>());
         }
 
         vertexMap(frontier,
                 [&](const VID& vid) {
+                    // left in the frontier by a fused round
+                    if (!graph.GetDegree(vid))
+                        return;
                     PAGEID pid, pid_end;
-                    _graph.GetPageRange(vid, &pid, &pid_end);
+                    graph.GetPageRange(vid, &pid, &pid_end);
+                    int disk_id;
+                    PAGEID pid_in_disk;
                     while (pid <= pid_end) {
-                        int disk_id = pid % num_disks;
-                        _sparse_page_frontier[disk_id]->push(pid++ >> num_disks_bit);
+                        graph.GetPageLocation(pid++, &disk_id, &pid_in_disk);
+                        page_bags[disk_id]->push(pid_in_disk);
                     }
                 });
+
+        // sort and deduplicate so that IO workers read each page once
+        // and can merge adjacent pages into a single request
+        page_frontier.resize(num_disks);
+        galois::do_all(galois::iterate(0, num_disks),
+                        [&](int i) {
+                            PageList* pages = new PageList(page_bags[i]->begin(), page_bags[i]->end());
+                            std::sort(pages->begin(), pages->end());
+                            pages->erase(std::unique(pages->begin(), pages->end()), pages->end());
+                            page_frontier[i] = pages;
+                        }, galois::no_stats(), galois::steal());
+
+        for (auto bag : page_bags) {
+            delete bag;
+        }
     }
 
-    void buildDensePageFrontier(Worklist<VID>* frontier) {
-        int num_disks = _graph.NumberOfDisks();
-        int num_disks_bit = (int)log2((float)num_disks);
+    void buildDensePageFrontier(Gr& graph, Worklist<VID>* frontier) {
+        int num_disks = graph.NumberOfDisks();
 
         if (!frontier) {
             for (int i = 0; i < num_disks; i++) {
-                _graph.GetActivatedPages(i)->set_all_parallel();
+                graph.GetActivatedPages(i)->set_all_parallel();
             }
             return;
         }
 
         vertexMap(frontier,
                 [&](const VID& vid) {
+                    // left in the frontier by a fused round
+                    if (!graph.GetDegree(vid))
+                        return;
                     PAGEID pid, pid_end;
-                    _graph.GetPageRange(vid, &pid, &pid_end);
+                    graph.GetPageRange(vid, &pid, &pid_end);
+                    int disk_id;
+                    PAGEID pid_in_disk;
                     while (pid <= pid_end) {
-                        int disk_id = pid % num_disks;
-                        _graph.GetActivatedPages(disk_id)
-                            ->set_bit_atomic(pid++ >> num_disks_bit);
+                        graph.GetPageLocation(pid++, &disk_id, &pid_in_disk);
+                        graph.GetActivatedPages(disk_id)->set_bit_atomic(pid_in_disk);
                     }
                 });
     }
@@ -268,18 +568,26 @@ class EdgeMapExecutor {
  private:
     Runtime&                    _runtime;
     Gr&                         _graph;
+    Gr*                         _in_graph;              // fused edgeMap only
     Worklist<VID>*              _out_frontier;          // Output worklist
     MPMCQueue<IoItem*>*         _fetched_tasks;
     IoEngine*                   _io_engine;             // IO engine
     ComputeEngine*              _compute_engine;        // Compute engine
     PBEngine*                   _pb_engine;             // PB engine
-    std::vector<CountableBag<PAGEID>*>     _sparse_page_frontier;  // Page frontier for sparse case
+    MemScheduler*               _mem_scheduler;         // Page scheduler in memory mode
+    std::vector<PageList*>      _sparse_page_frontier;  // Page frontier for sparse case
+    std::vector<PageList*>      _in_sparse_page_frontier;   // of _in_graph
     Func&                       _func;
     FLAGS                       _flags;
     bool                        _work_exists;
     uint64_t                    _num_activated_nodes;
     uint64_t                    _num_activated_edges;
     FrontierType                _frontier_type;
+    bool                        _inline;                // run by the calling thread
+    std::vector<std::pair<PAGEID, VID>> _inline_blocks; // block and a vertex with edges in it
+    uint64_t                    _inline_io_bytes;
+    uint64_t                    _inline_cached_bytes;   // taken from the page cache
+    std::vector<uint64_t>       _inline_device_bytes;
     double                      _io_time;
     double                      _compute_time;
 };
@@ -298,6 +606,187 @@ Worklist<VID>* edgeMap(G& graph, F&& func, FLAGS flags = 0) {
     return executor.newFrontier();
 }
 
+/*
+ * Fused edgeMap: the same frontier and function over the edges of an
+ * out-graph and an in-graph, as edgeMap on each of them one after the
+ * other. The IO workers read the page sets of both graphs in one pass and
+ * the compute (or scatter) workers tell the pages apart by their tag, so
+ * the round ends at a single barrier. Vertices without edges stay in the
+ * frontier. In memory the two edgeMaps simply run one after the other.
+ */
+template <typename G, typename F>
+Worklist<VID>* edgeMap(G& out_graph, G& in_graph, Worklist<VID>* frontier, F&& func, FLAGS flags = 0) {
+    if (Runtime::getRuntimeInstance().getConfig().in_memory) {
+        // the first edgeMap drops vertices without out-edges from frontier
+        Worklist<VID>* in_frontier = nullptr;
+        if (frontier && frontier->is_dense()) {
+            Bitmap* bitmap = new Bitmap(in_graph.NumberOfNodes());
+            std::vector<Bitmap*> bitmaps = { frontier->get_dense() };
+            Bitmap::or_bitmaps(bitmaps, bitmap);
+            in_frontier = new Worklist<VID>(bitmap);
+        } else if (frontier) {
+            auto sparse = new CountableBag<VID>();
+            galois::do_all(galois::iterate(*frontier->get_sparse()),
+                        [&](const VID& node) {
+                            sparse->push(node);
+                        }, galois::no_stats());
+            in_frontier = new Worklist<VID>(in_graph.NumberOfNodes(), sparse);
+        }
+
+        Worklist<VID>* out = edgeMap(out_graph, frontier, func, flags);
+        if (use_prop_blocking(flags))
+            func.get_bins()->reset();
+        Worklist<VID>* in = edgeMap(in_graph, in_frontier, func, flags);
+        if (in_frontier)
+            delete in_frontier;
+        if (!out || !in)
+            return out ? out : in;
+        if (!out->is_dense())
+            out->to_dense();
+        if (!in->is_dense())
+            in->to_dense();
+        std::vector<Bitmap*> bitmaps = { out->get_dense(), in->get_dense() };
+        Bitmap::or_bitmaps(bitmaps, out->get_dense());
+        delete in;
+        return out;
+    }
+
+    EdgeMapExecutor<G, F> executor(out_graph, frontier, std::forward<F>(func), flags, &in_graph);
+    executor.run();
+    return executor.newFrontier();
+}
+
+// One edgeMap of a shared scan: its frontier (nullptr for all vertices),
+// function and flags. The output frontier has the density of the round.
+template <typename Func>
+struct ScanQuery {
+    Worklist<VID>*  frontier;
+    Func            func;
+    FLAGS           flags;
+    Worklist<VID>*  out;
+};
+
+template <typename F>
+ScanQuery<F> scan(Worklist<VID>* frontier, F&& func, FLAGS flags = 0) {
+    return ScanQuery<F>{ frontier, std::forward<F>(func), flags, nullptr };
+}
+
+// Applies every query whose frontier holds src to an edge of the union
+template <typename... Qs>
+struct SharedScanF {
+    std::tuple<Qs&...> queries;
+
+    SharedScanF(Qs&... qs): queries(qs...) {}
+
+    inline bool cond(VID dst) {
+        return true;
+    }
+
+    inline bool updateAtomic(VID src, VID dst, EDGEDATA data) {
+        std::apply([&](auto&... q) { (apply(q, src, dst, data), ...); }, queries);
+        return false;
+    }
+
+    template <typename Q>
+    static inline void apply(Q& q, VID src, VID dst, EDGEDATA data) {
+        if (q.frontier && !q.frontier->activated(src))
+            return;
+        if (q.func.cond(dst) && applyUpdateAtomic(q.func, src, dst, data) && q.out)
+            q.out->activate(dst);
+    }
+
+    // no get_bins(): never binned, nor compiled for the prop-blocking engine
+};
+
+/*
+ * Shared scan: runs several independent edgeMaps over one pass of IO.
+ * The pages of the union of the frontiers are read once and each edge is
+ * given to every query whose frontier holds its source. The round is
+ * dense or sparse by the threshold of edgeMap, taken over the sum of the
+ * query frontiers (which bounds their union); a sparse round keeps every
+ * frontier and output sparse, so it stays O(frontier) and may run inline.
+ * Only functions with updateAtomic; binned ones keep bins of their own.
+ * Returns the output frontiers in the order of the queries.
+ */
+template <typename G, typename... Qs>
+std::array<Worklist<VID>*, sizeof...(Qs)> edgeMapShared(G& graph, Qs&&... queries) {
+    static_assert(sizeof...(Qs) > 0, "No query");
+    uint64_t n = graph.NumberOfNodes();
+
+    bool all = false;
+    galois::GAccumulator<uint64_t> work;
+    auto prepare = [&](auto& q) {
+        if (use_prop_blocking(q.flags))
+            BLAZE_DIE("edgeMapShared does not support prop_blocking");
+        if (!q.frontier) {
+            all = true;
+            return;
+        }
+        work += q.frontier->count();
+        vertexMap(q.frontier,
+                [&](const VID& node) {
+                    work += graph.GetDegree(node);
+                });
+    };
+    (prepare(queries), ...);
+    bool dense = all || work.reduce() > graph.NumberOfEdges() * DENSE_THRESHOLD;
+
+    // as ComputeEngine::setFrontier, the outputs follow the frontier
+    auto output = [&](auto& q) {
+        if (should_output(q.flags)) {
+            q.out = new Worklist<VID>(n);
+            if (dense)
+                q.out->to_dense();
+        }
+    };
+    (output(queries), ...);
+
+    Worklist<VID>* frontier = nullptr;
+    if (!dense) {
+        // sources of all queries, each once; the query frontiers keep
+        // their bitmaps for SharedScanF to check membership
+        std::vector<VID> sources;
+        auto collect = [&](auto& q) {
+            if (q.frontier->is_dense()) {
+                q.frontier->to_sparse();
+            } else {
+                q.frontier->fill_dense();
+            }
+            CountableBag<VID>* bag = q.frontier->get_sparse();
+            sources.insert(sources.end(), bag->begin(), bag->end());
+        };
+        (collect(queries), ...);
+        std::sort(sources.begin(), sources.end());
+        sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+        CountableBag<VID>* bag = new CountableBag<VID>();
+        galois::do_all(galois::iterate(sources),
+                        [&](VID vid) {
+                            bag->push(vid);
+                        }, galois::no_stats());
+        frontier = new Worklist<VID>(n, bag);
+
+    } else if (!all) {
+        std::vector<Bitmap*> bitmaps;
+        auto collect = [&](auto& q) {
+            if (!q.frontier->is_dense())
+                q.frontier->to_dense();
+            bitmaps.push_back(q.frontier->get_dense());
+        };
+        (collect(queries), ...);
+        Bitmap* bitmap = new Bitmap(n);
+        Bitmap::or_bitmaps(bitmaps, bitmap);
+        frontier = new Worklist<VID>(bitmap);
+    }
+
+    SharedScanF<std::remove_reference_t<Qs>...> func(queries...);
+    edgeMap(graph, frontier, func, no_output);
+
+    if (frontier)
+        delete frontier;
+
+    return { queries.out... };
+}
+
 } // namespace blaze
 
 #endif // BLAZE_PARALLEL_FOR_H
@@ -6,13 +6,15 @@
 #include "galois/Bag.h"
 #include "Synchronization.h"
 #include "Bin.h"
+#include "Wait.h"
 
 namespace blaze {
 
 class GatherWorker {
  public:
-    GatherWorker(int id)
+    GatherWorker(int id, int node = 0)
         :   _id(id),
+            _node(node),
             _time(0.0),
             _out_frontier(nullptr)
     {}
@@ -25,26 +27,23 @@ class GatherWorker {
 
     template <typename Func>
     inline bool try_gather(Bins* bins, Func &func) {
-        Bin *full_bin = bins->get_full_bin();
+        Bin *full_bin = bins->get_full_bin(_node);
         if (!full_bin)
             return false;
 
-        uint64_t *bin = full_bin->get_bin();
-        uint64_t bin_size = full_bin->get_size();
+        using T = typename Func::value_type;
+        BinEntry *bin = full_bin->get_bin();
         int idx = full_bin->get_idx();
 
         if (_out_frontier) {
             for (int i = 0; i < idx; i++) {
-                VID dst = (VID)(bin[i]>> 32);
-                uint32_t val = (uint32_t)(bin[i] & 0x00000000ffffffff);
-                if (func.gather(dst, *(typename Func::value_type *)&val))
+                VID dst = bin[i].dst();
+                if (func.gather(dst, bin[i].template value<T>()))
                     _out_frontier->activate(dst);
             }
         } else {
             for (int i = 0; i < idx; i++) {
-                VID dst = (VID)(bin[i]>> 32);
-                uint32_t val = (uint32_t)(bin[i] & 0x00000000ffffffff);
-                func.gather(dst, *(typename Func::value_type *)&val);
+                func.gather(bin[i].dst(), bin[i].template value<T>());
             }
         }
 
@@ -63,6 +62,7 @@ class GatherWorker {
 
         bool binning_done = false;
         bool job_exists;
+        Waiter waiter(WAIT_FULL_BINS, &bins->get_full_bins_parking());
 
         while (1) {
             job_exists = try_gather(bins, func);
@@ -70,8 +70,13 @@ class GatherWorker {
             if (binning_done && !job_exists)
                 break;
 
+            if (job_exists)
+                waiter.done();
+
             if (sync.check_binning_done()) {
                 if (!binning_done) binning_done = true;
+            } else if (!job_exists) {
+                waiter.wait();
             }
         }
 
@@ -92,6 +97,7 @@ class GatherWorker {
 
  private:
     int                     _id;
+    int                     _node;
     double                  _time;
     Worklist<VID>*          _out_frontier;
 };
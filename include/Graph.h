@@ -4,16 +4,22 @@
 #include <string>
 #include <unordered_map>
 #include <map>
+#include <limits>
 #include <omp.h>
+#include <immintrin.h>
 //#include <locale.h>
 #include <boost/iterator/counting_iterator.hpp>
 #include "filesystem.h"
 #include "galois/Galois.h"
 #include "Bitmap.h"
 #include "Util.h"
+#include "Compression.h"
 
 namespace blaze {
 
+// Build the full edge offset index with each graph, set by Runtime from the config
+inline bool fullOffsetIndex = false;
+
 class Graph {
  public:
     using iterator = boost::counting_iterator<VID>;
@@ -22,7 +28,10 @@ class Graph {
     Graph(): _input_index_file_base(nullptr), _input_index_file_len(0),
              _num_disks(0), _input_edge_file_descs(nullptr), _num_nodes(0), _num_empty_nodes(0),
              _non_empty_nodes(nullptr), _num_edges(0),
-             _index_offsets(nullptr), _index_degrees(nullptr), _num_disk_pages(0), _p2v_map(nullptr),
+             _index_offsets(nullptr), _index_degrees(nullptr), _offsets(nullptr),
+             _compressed(false), _weighted(false), _edge_shift(EDGE_WIDTH_BITS),
+             _index_byte_offsets(nullptr), _index_sizes(nullptr),
+             _block_size(PAGE_SIZE), _block_shift(PAGE_SHIFT), _num_disk_pages(0), _p2v_map(nullptr),
              _activated_pages(nullptr) {}
     ~Graph() {
         if (_input_edge_file_descs) {
@@ -46,6 +55,11 @@ class Graph {
         }
         if (_non_empty_nodes)
             delete _non_empty_nodes;
+        if (_offsets)
+            delete [] _offsets;
+        for (size_t i = 0; i < _edge_data.size(); i++) {
+            munmap(_edge_data[i], _edge_data_len[i]);
+        }
     }
 
     VID NumberOfNodes() const { return _num_nodes; }
@@ -56,7 +70,7 @@ class Graph {
 
     uint64_t NumberOfEdges() const { return _num_edges; }
 
-    uint64_t GetEdgeSize() const { return NumberOfEdges() * sizeof(VID); }
+    uint64_t GetEdgeSize() const { return NumberOfEdges() << _edge_shift; }
 
     int NumberOfDisks() const { return _num_disks; }
 
@@ -66,27 +80,134 @@ class Graph {
 
     std::string GetEdgeFileName(int idx) const { return _input_edge_files[idx]; }
 
+    // Edge files are read in blocks ("pages") of this many bytes
+    uint32_t GetBlockSize() const { return _block_size; }
+
+    int GetBlockShift() const { return _block_shift; }
+
+    // Block size recorded in an index file, without loading the graph
+    static uint32_t ReadBlockSize(const std::string& index_file) {
+        struct graph_header header;
+        int fd = open(index_file.c_str(), O_RDONLY);
+        if (fd < 0) BLAZE_SYS_DIE("Failed to open ", index_file);
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header))
+            BLAZE_SYS_DIE("Failed to read ", index_file);
+        close(fd);
+        return header.block_size ? header.block_size : PAGE_SIZE;
+    }
+
     uint32_t GetDegree(VID node) const {
         return _index_degrees[node];
     }
 
+    // Edge blocks of Compression.h
+    bool IsCompressed() const {
+        return _compressed;
+    }
+
+    // EdgePair tuples with edge data instead of bare vertex ids
+    bool IsWeighted() const {
+        return _weighted;
+    }
+
+    // Bytes of the edge files taken by the edges of node, with the padding
+    // after them
+    uint64_t GetEdgeBytes(VID node) const {
+        if (_index_sizes)
+            return _index_sizes[node];
+        return (uint64_t)GetDegree(node) << _edge_shift;
+    }
+
+    // Where the edges of node start in the edge files
+    uint64_t GetByteOffset(VID node) const {
+        if (_index_sizes)
+            return _index_byte_offsets[node >> 4] + SumBlock(_index_sizes, node);
+        return GetOffset(node) << _edge_shift;
+    }
+
+    // First edge of node: from the full index if it was built, otherwise
+    // the checkpoint of its block of 16 vertices plus the degrees before it
     uint64_t GetOffset(VID node) const {
-        uint64_t offset = _index_offsets[node >> 4];
-        VID beg = (node >> 4) << 4;
-        while (beg < node) {
-            offset += _index_degrees[beg++];
+        if (_offsets)
+            return _offsets[node];
+        return _index_offsets[node >> 4] + SumBlock(_index_degrees, node);
+    }
+
+    // Values of the vertices before node in its block, which is one
+    // cache line of the index; the converter pads the last block
+    static uint64_t SumBlock(const uint32_t* values, VID node) {
+        const uint32_t* block = values + ((uint64_t)node & ~15ul);
+        int count = node & 15;
+#ifdef __AVX2__
+        const __m256i lanes_lo = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i lanes_hi = _mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15);
+        __m256i k = _mm256_set1_epi32(count);
+        __m256i lo = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)block),
+                                      _mm256_cmpgt_epi32(k, lanes_lo));
+        __m256i hi = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(block + 8)),
+                                      _mm256_cmpgt_epi32(k, lanes_hi));
+        // in 64-bit lanes, 15 degrees may not add up within 32 bits
+        __m256i sum = _mm256_add_epi64(
+                        _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(lo)),
+                                         _mm256_cvtepu32_epi64(_mm256_extracti128_si256(lo, 1))),
+                        _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(hi)),
+                                         _mm256_cvtepu32_epi64(_mm256_extracti128_si256(hi, 1))));
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        return _mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1);
+#else
+        uint64_t sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += block[i];
         }
-        return offset;
+        return sum;
+#endif
     }
 
+    // Edge pages are striped round-robin over the edge files
+    void GetPageLocation(PAGEID pid, int *disk_id, PAGEID *pid_in_disk) const {
+        *pid_in_disk = _disk_divisor.divide(pid);
+        *disk_id = pid - *pid_in_disk * _num_disks;
+    }
+
+    // Blocks holding the edges of a non-empty node, both inclusive
     void GetPageRange(VID node, PAGEID *beg, PAGEID *end) const {
-        uint32_t degree = GetDegree(node);
-        uint64_t offset = GetOffset(node);
-        uint64_t on_disk_offset = offset * sizeof(VID);
-        *beg = PAGE_NUM(on_disk_offset);
-        *end = PAGE_NUM(on_disk_offset + degree * sizeof(VID));
-        if (*end == _num_disk_pages) {
-            *end -= 1;
+        uint64_t offset = GetByteOffset(node);
+        *beg = offset >> _block_shift;
+        *end = (offset + GetEdgeBytes(node) - 1) >> _block_shift;
+    }
+
+    // Call f(dst, data) for the edges of a node that lie in the block at
+    // page_start, read into buffer; [offset, offset_end) are its bytes.
+    // Unweighted edges carry EDGEDATA_UNIT.
+    template <typename F>
+    void ForEachEdgeInBlock(uint32_t degree, uint64_t offset, uint64_t offset_end,
+                            uint64_t page_start, const char* buffer, F&& f) const {
+        uint64_t page_end = page_start + _block_size;
+        if (_compressed) {
+            if (offset_end <= page_start || offset >= page_end)
+                return;
+            auto header = (const CompressedBlockHeader*)buffer;
+            uint32_t count = offset_end > page_end ? header->last_count
+                           : offset < page_start ? degree - header->first_skip
+                           : degree;
+            uint64_t begin = std::max(offset, page_start + sizeof(*header));
+            GroupVarint::decode((const uint8_t*)buffer + (begin - page_start), count,
+                                [&](VID dst) { f(dst, EDGEDATA_UNIT); });
+            return;
+        }
+
+        // not into the padding of an aligned layout
+        offset_end = offset + ((uint64_t)degree << _edge_shift);
+        const char* begin = buffer + (std::max(offset, page_start) - page_start);
+        const char* end = buffer + (std::min(offset_end, page_end) - page_start);
+        if (_weighted) {
+            for (auto edge = (const EdgePair*)begin; edge < (const EdgePair*)end; edge++) {
+                f(edge->dst, edge->data);
+            }
+        } else {
+            for (auto edge = (const VID*)begin; edge < (const VID*)end; edge++) {
+                f(*edge, EDGEDATA_UNIT);
+            }
         }
     }
 
@@ -95,42 +216,32 @@ class Graph {
         assert(_num_disks);
         std::vector<VID> result;
 
-        size_t degree = GetDegree(node);
-        uint64_t offset = GetOffset(node);
-        uint64_t on_disk_offset = offset * sizeof(VID);
-
+        uint32_t degree = GetDegree(node);
         if (degree == 0) return result;
 
+        uint64_t offset = GetByteOffset(node);
+        uint64_t offset_end = offset + GetEdgeBytes(node);
+
         PAGEID pid, pid_end;
         GetPageRange(node, &pid, &pid_end);
-        size_t page_size = PAGE_SIZE * (pid_end - pid + 1);
         char* buf;
-        int ret = posix_memalign((void**)&buf, PAGE_SIZE, page_size);
+        int ret = posix_memalign((void**)&buf, PAGE_SIZE, _block_size);
         assert(ret == 0);
 
-        char *p = buf;
-
         while (pid <= pid_end) {
-            int disk_id = pid % _num_disks;
-            PAGEID phy_pid = pid / _num_disks;
+            int disk_id;
+            PAGEID phy_pid;
+            GetPageLocation(pid, &disk_id, &phy_pid);
 
             int fd = GetEdgeFileDescriptor(disk_id);
             assert(fd > 0);
-            int ret = pread(fd, p, PAGE_SIZE, phy_pid * PAGE_SIZE);
+            int ret = pread(fd, buf, _block_size, (uint64_t)phy_pid * _block_size);
 
-            p = (char *)((uint64_t)p + PAGE_SIZE);
+            ForEachEdgeInBlock(degree, offset, offset_end, (uint64_t)pid << _block_shift, buf,
+                                [&](VID dst, EDGEDATA) { result.push_back(dst); });
             pid++;
         }
 
-        char* beg = buf + OFFSET_IN_PAGE(on_disk_offset);
-        const char* end = beg + degree * sizeof(VID);
-
-        while (beg < end) {
-            VID dst = *(VID *)beg;
-            result.push_back(dst);
-            beg += sizeof(VID);
-        }
-
         free(buf);
 
         return result;
@@ -138,8 +249,8 @@ class Graph {
 
     uint64_t GetNumPages(int idx) const {
         uint64_t size = GetEdgeFileSize(idx);
-        assert(size % PAGE_SIZE == 0);
-        return size / PAGE_SIZE;
+        assert(size % _block_size == 0);
+        return size >> _block_shift;
     }
 
     uint64_t GetTotalNumPages() const {
@@ -154,6 +265,52 @@ class Graph {
         return *_p2v_map;
     }
 
+    bool IsInMemory() const {
+        return !_edge_data.empty();
+    }
+
+    // In-memory mode only: page pid_in_disk of edge file idx
+    char* GetEdgePage(int idx, PAGEID pid_in_disk) const {
+        return _edge_data[idx] + ((uint64_t)pid_in_disk << _block_shift);
+    }
+
+    // Read every edge file into (transparent) huge pages once, so that
+    // edgeMap can hand pages to compute workers without the IO engine.
+    void LoadEdgesInMemory() {
+        if (IsInMemory())
+            return;
+
+        _edge_data.resize(_num_disks);
+        _edge_data_len.resize(_num_disks);
+        galois::do_all(galois::iterate(0, _num_disks),
+                        [&](int i) {
+                            uint64_t size = GetEdgeFileSize(i);
+                            uint64_t len = ALIGN_UPTO(size, HUGE_PAGE_SIZE);
+                            char* base = (char*)mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                            if (base == MAP_FAILED)
+                                BLAZE_SYS_DIE("Failed to allocate memory for ", _input_edge_files[i]);
+                            madvise(base, len, MADV_HUGEPAGE);
+
+                            int fd = open(_input_edge_files[i].c_str(), O_RDONLY);
+                            if (fd < 0)
+                                BLAZE_SYS_DIE("Failed to open ", _input_edge_files[i]);
+                            uint64_t done = 0;
+                            while (done < size) {
+                                ssize_t ret = pread(fd, base + done, std::min(size - done, (uint64_t)MAX_WRITE_IO_SIZE), done);
+                                if (ret <= 0)
+                                    BLAZE_SYS_DIE("Failed to read ", _input_edge_files[i]);
+                                done += ret;
+                            }
+                            close(fd);
+
+                            _edge_data[i] = base;
+                            _edge_data_len[i] = len;
+                        }, galois::no_stats());
+
+        printf("Edges in memory: %lu MB\n", GetTotalEdgeFileSize() / MB);
+    }
+
     Bitmap* GetActivatedPages(int idx) {
         return _activated_pages[idx];
     }
@@ -168,6 +325,10 @@ class Graph {
 
         InitVertices();
 
+        // padded or compressed edges are found by the byte block sums only
+        if (fullOffsetIndex && !_index_sizes)
+            InitFullOffsets();
+
         InitEdgeFileDescriptors(input_edge_files);
 
         InitPage2VertexMap();
@@ -201,8 +362,18 @@ class Graph {
     }
 
     void Print() {
-        printf("V: %'15u (%'u, %.1f%%)\n", _num_nodes, NumberOfNonEmptyNodes(), (double)NumberOfNonEmptyNodes() * 100.0 / _num_nodes);
+        printf("V: %'15lu (%'lu, %.1f%%)\n", (uint64_t)_num_nodes, (uint64_t)NumberOfNonEmptyNodes(), (double)NumberOfNonEmptyNodes() * 100.0 / _num_nodes);
         printf("E: %'15lu\n", _num_edges);
+        if (_block_size != PAGE_SIZE)
+            printf("Block size: %u kB\n", _block_size / kB);
+        if (_compressed)
+            printf("Edges: compressed, %.2f bytes per edge\n",
+                (double)GetTotalEdgeFileSize() / std::max(_num_edges, (uint64_t)1));
+        else if (_index_sizes)
+            printf("Edges: aligned, %.2f%% padding\n",
+                (double)(GetTotalEdgeFileSize() - GetEdgeSize()) * 100.0 / GetTotalEdgeFileSize());
+        if (_weighted)
+            printf("Edges: weighted, %d bytes per edge\n", 1 << _edge_shift);
     }
 
  private:
@@ -216,12 +387,51 @@ class Graph {
         size_t len_header_aligned = ALIGN_UPTO(len_header, CACHE_LINE);
         _index_degrees = (uint32_t *)(_input_index_file_base + len_header_aligned);
 
+        // byte checkpoints and sizes follow the degrees, laid out the same;
+        // compressed edges always have them
+        if (header->flags & (GRAPH_BYTE_INDEX | GRAPH_COMPRESSED)) {
+            size_t len_degrees = num_offsets * CACHE_LINE;
+            size_t len_byte_offsets = ALIGN_UPTO(num_offsets * sizeof(uint64_t), CACHE_LINE);
+            _index_byte_offsets = (uint64_t *)(_input_index_file_base + len_header_aligned + len_degrees);
+            _index_sizes = (uint32_t *)((char *)_index_byte_offsets + len_byte_offsets);
+        }
+        _compressed = header->flags & GRAPH_COMPRESSED;
+        _weighted = header->flags & GRAPH_WEIGHTED;
+        _edge_shift = _weighted ? __builtin_ctz(sizeof(EdgePair)) : EDGE_WIDTH_BITS;
+
+        // the edge files hold ids of one width, which the build has to match
+        if (!(header->flags & GRAPH_VID64) != (sizeof(VID) == 4))
+            BLAZE_DIE(input, header->flags & GRAPH_VID64
+                        ? ": 64-bit vertex ids, build with -DBLAZE_VID64=ON"
+                        : ": 32-bit vertex ids, convert it again or build without BLAZE_VID64");
+
         this->_num_nodes = header->num_nodes;
         this->_num_edges = header->num_edges;
+
+        uint64_t block_size = header->block_size ? header->block_size : PAGE_SIZE;
+        if (block_size < PAGE_SIZE || block_size > MAX_BLOCK_SIZE || (block_size & (block_size - 1)))
+            BLAZE_DIE(input, ": invalid block size ", block_size);
+        this->_block_size = block_size;
+        this->_block_shift = __builtin_ctz(block_size);
         this->_input_index_file = input;
     }
 
-    // TODO: adjust disk offsets to align the first vertex to the first page
+    // 8 bytes per vertex for an offset lookup without the block sum
+    void InitFullOffsets() {
+        uint64_t* offsets = new uint64_t[_num_nodes];
+        uint64_t num_blocks = ((uint64_t)_num_nodes + 15) / 16;
+        galois::do_all(galois::iterate((uint64_t)0, num_blocks),
+                        [&](uint64_t b) {
+                            uint64_t offset = _index_offsets[b];
+                            VID end = std::min((uint64_t)_num_nodes, (b + 1) * 16);
+                            for (VID vid = b * 16; vid < end; vid++) {
+                                offsets[vid] = offset;
+                                offset += _index_degrees[vid];
+                            }
+                        }, galois::no_stats());
+        _offsets = offsets;
+        printf("Offset index: %lu MB\n", (uint64_t)_num_nodes * sizeof(uint64_t) / MB);
+    }
 
     void InitVertices() {
         _non_empty_nodes = new Bitmap(_num_nodes);
@@ -241,32 +451,39 @@ class Graph {
 
         VID prev_vid, curr_vid, vid_start;
         PAGEID prev_pid, curr_pid;
+        uint64_t offset = 0;        // byte offset of curr_vid, running
 
         vid_start = prev_vid = curr_vid = 0;
         prev_pid = 0;
 
         while (curr_vid < _num_nodes) {
-            if (GetDegree(curr_vid) == 0) {
+            uint32_t degree = GetDegree(curr_vid);
+            uint64_t bytes = GetEdgeBytes(curr_vid);
+            if (degree == 0) {
                 curr_vid++;
+                offset += bytes;
                 continue;
             }
 
-            uint64_t on_disk_offset = GetOffset(curr_vid) * sizeof(VID);
-            curr_pid = PAGE_NUM(on_disk_offset);
+            curr_pid = offset >> _block_shift;
             if (prev_pid < curr_pid) {
-                _createEntries(&vid_start, prev_vid, curr_vid);
+                _createEntries(&vid_start, prev_vid, curr_vid, offset);
                 prev_pid = curr_pid;
             }
             prev_vid = curr_vid;
             curr_vid++;
+            offset += bytes;
         }
-        _createEntries(&vid_start, prev_vid, curr_vid);
+        // no vertex follows the last one to share its last block
+        if (_num_edges)
+            _createEntries(&vid_start, prev_vid, curr_vid, UINT64_MAX);
     }
 
     void InitEdgeFileDescriptors(std::vector<std::string>& files) {
         assert(_input_edge_file_descs == nullptr);
         _num_disks = files.size();
         assert(_num_disks);
+        _disk_divisor = FastDivisor(_num_disks);
 
         _input_edge_file_descs = new int [_num_disks];
         for (int i = 0; i < _num_disks; i++) {
@@ -278,6 +495,8 @@ class Graph {
         }
 
         _num_disk_pages = GetTotalNumPages();
+        if (_num_disk_pages > (uint64_t)std::numeric_limits<PAGEID>::max())
+            BLAZE_DIE(_num_disk_pages, " edge blocks, build with -DBLAZE_PAGEID64=ON or convert with a larger -blockSize");
     }
 
     void InitPageActivationStructures() {
@@ -291,27 +510,26 @@ class Graph {
         }
     }
 
-    void _createEntries(VID *vid_start, VID vid, VID next_vid) {
-        uint32_t degree = GetDegree(vid);
-        uint64_t offset = GetOffset(vid)* sizeof(VID);
-        uint64_t offset_end = offset + degree * sizeof(VID);
-        assert(degree > 0);
+    // Map the blocks of vid; its last one is left to next_vid, starting at
+    // next_offset, when they share it
+    void _createEntries(VID *vid_start, VID vid, VID next_vid, uint64_t next_offset) {
+        uint64_t offset = GetByteOffset(vid);
+        uint64_t offset_end = offset + GetEdgeBytes(vid);
+        assert(GetDegree(vid) > 0);
 
-        PAGEID pid = offset >> PAGE_SHIFT;
+        PAGEID pid = offset >> _block_shift;
         _p2v_map[pid++] = std::make_pair(*vid_start, vid);
-        PAGEID last_pid = (offset_end - 1) >> PAGE_SHIFT;
-        if (pid <= last_pid) {
-            while (pid < last_pid) {
-                _p2v_map[pid++] = std::make_pair(vid, vid);
-            }
-            if (offset_end % PAGE_SIZE == 0) {
-                _p2v_map[last_pid] = std::make_pair(vid, vid);
-            }
+        PAGEID last_pid = (offset_end - 1) >> _block_shift;
+        while (pid < last_pid) {
+            _p2v_map[pid++] = std::make_pair(vid, vid);
         }
-        if (offset_end % PAGE_SIZE) {
-            *vid_start = vid;
-        } else {
+        // the next vertex may start past the padding after vid
+        if (next_offset >> _block_shift > last_pid) {
+            if (pid == last_pid)
+                _p2v_map[last_pid] = std::make_pair(vid, vid);
             *vid_start = next_vid;
+        } else {
+            *vid_start = vid;
         }
     }
 
@@ -321,6 +539,7 @@ class Graph {
     size_t                      _input_index_file_len;
     std::vector<std::string>    _input_edge_files;
     int                         _num_disks;
+    FastDivisor                 _disk_divisor;
     int*                        _input_edge_file_descs;
     VID                         _num_nodes;
     VID                         _num_empty_nodes;
@@ -328,10 +547,21 @@ class Graph {
     uint64_t                    _num_edges;
     uint64_t*                   _index_offsets;
     uint32_t*                   _index_degrees;
+    uint64_t*                   _offsets;           // full index, optional
+    bool                        _compressed;
+    bool                        _weighted;
+    int                         _edge_shift;        // log2 of the bytes of an edge tuple
+    uint64_t*                   _index_byte_offsets;    // byte index only
+    uint32_t*                   _index_sizes;           // byte index only
+    uint32_t                    _block_size;
+    int                         _block_shift;
     uint64_t                    _num_disk_pages;
     VidRange*                   _p2v_map;
     // Below data structures need for each disk
     Bitmap**                    _activated_pages;
+    // in-memory mode
+    std::vector<char*>          _edge_data;
+    std::vector<uint64_t>       _edge_data_len;
 };
 
 } // namespace blaze
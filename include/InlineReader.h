@@ -0,0 +1,180 @@
+#ifndef BLAZE_INLINE_READER_H
+#define BLAZE_INLINE_READER_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "AsyncIo.h"
+#include "IoUring.h"
+#include "Config.h"
+#include "Util.h"
+#include "Param.h"
+
+namespace blaze {
+
+// One edge block to read
+struct InlineRead {
+    int         fd;
+    PAGEID      ppid;       // block in the file
+};
+
+/*
+ * Reads the few edge blocks of a tiny frontier on the calling thread,
+ * through the IO backend the IO workers use. The aio context and ring are
+ * set up once for max_reads, since tearing one down waits for an RCU grace
+ * period; the buffer is kept across rounds and only grows. A round costs
+ * one submission and a few waits for completions.
+ */
+class InlineReader {
+ public:
+    InlineReader(IoBackend backend, uint32_t max_reads)
+        :   _backend(backend), _ctx(0), _depth(max_reads), _buf(nullptr), _buf_size(0),
+            _iocb(max_reads), _iocbs(max_reads), _events(max_reads)
+    {
+        // aio also serves io_uring rounds that run out of file slots
+        if (io_setup(max_reads, &_ctx))
+            BLAZE_SYS_DIE("Inline read: io_setup failed");
+        if (_backend == IO_BACKEND_URING)
+            _ring.init(max_reads, false, false);
+    }
+
+    ~InlineReader() {
+        io_destroy(_ctx);
+        if (_buf)
+            free(_buf);
+    }
+
+    // Submit all reads at once and call on_read(i, buf) for reads[i] as it
+    // completes, in completion order
+    template <typename F>
+    void read(const std::vector<InlineRead>& reads, uint32_t block_size, F&& on_read) {
+        uint32_t num = reads.size();
+        if (!num) return;
+        BLAZE_ASSERT(num <= _depth, "Too many inline reads");
+        reserveBuffer(num, block_size);
+
+        // io_uring reads go through fixed file slots; a round touching more
+        // files than the ring has slots falls back to aio
+        if (_backend == IO_BACKEND_URING && assignFileSlots(reads)) {
+            readUring(reads, block_size, on_read);
+            return;
+        }
+
+        for (uint32_t i = 0; i < num; i++) {
+            struct iocb* cb = &_iocb[i];
+            memset(cb, 0, sizeof(*cb));
+            cb->aio_fildes = reads[i].fd;
+            cb->aio_lio_opcode = IOCB_CMD_PREAD;
+            cb->aio_buf = (uint64_t)(_buf + (uint64_t)i * block_size);
+            cb->aio_nbytes = block_size;
+            cb->aio_offset = (uint64_t)reads[i].ppid * block_size;
+            cb->aio_data = i;
+            _iocbs[i] = cb;
+        }
+
+        uint32_t sent = 0;
+        while (sent < num) {
+            int ret = io_submit(_ctx, num - sent, _iocbs.data() + sent);
+            if (ret < 0) BLAZE_SYS_DIE("Inline read: io_submit failed");
+            sent += ret;
+        }
+
+        uint32_t received = 0;
+        while (received < num) {
+            int ret = io_getevents(_ctx, 1, num - received, _events.data(), NULL);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                BLAZE_SYS_DIE("Inline read: io_getevents failed");
+            }
+            for (int i = 0; i < ret; i++) {
+                uint32_t idx = _events[i].data;
+                if (_events[i].res != (int64_t)block_size)
+                    BLAZE_DIE("Inline read: short read of block ", reads[idx].ppid);
+                on_read(idx, _buf + (uint64_t)idx * block_size);
+            }
+            received += ret;
+        }
+    }
+
+ private:
+    template <typename F>
+    void readUring(const std::vector<InlineRead>& reads, uint32_t block_size, F&& on_read) {
+        uint32_t num = reads.size();
+        for (uint32_t i = 0; i < num; i++) {
+            _ring.prepRead(_read_slots[i], _buf + (uint64_t)i * block_size, block_size,
+                           (uint64_t)reads[i].ppid * block_size, -1, (void*)(uintptr_t)i);
+        }
+        _ring.submit();
+
+        // short reads are completed by the ring before they are reaped
+        std::vector<void*> datas(num);
+        uint32_t received = 0;
+        while (received < num) {
+            unsigned ret = _ring.reap(datas.data(), num - received);
+            if (!ret) {
+                _ring.waitCompletion();
+                continue;
+            }
+            for (unsigned i = 0; i < ret; i++) {
+                uint32_t idx = (uintptr_t)datas[i];
+                on_read(idx, _buf + (uint64_t)idx * block_size);
+            }
+            received += ret;
+        }
+    }
+
+    // Slot of each read in _read_slots; a slot is only pointed at another
+    // file when the round needs it. Returns false if the slots run out.
+    bool assignFileSlots(const std::vector<InlineRead>& reads) {
+        uint32_t num = reads.size();
+        std::vector<int> fds;
+        _read_slots.resize(num);
+        for (uint32_t i = 0; i < num; i++) {
+            auto it = std::find(fds.begin(), fds.end(), reads[i].fd);
+            if (it == fds.end()) {
+                if (fds.size() == IO_URING_MAX_FILES)
+                    return false;
+                it = fds.insert(fds.end(), reads[i].fd);
+            }
+            _read_slots[i] = it - fds.begin();
+        }
+
+        _slot_fds.resize(std::max(_slot_fds.size(), fds.size()), -1);
+        for (size_t slot = 0; slot < fds.size(); slot++) {
+            if (_slot_fds[slot] != fds[slot]) {
+                _ring.updateFile(slot, fds[slot]);
+                _slot_fds[slot] = fds[slot];
+            }
+        }
+        return true;
+    }
+
+    void reserveBuffer(uint32_t num, uint32_t block_size) {
+        uint64_t size = (uint64_t)num * block_size;
+        if (size > _buf_size) {
+            if (_buf)
+                free(_buf);
+            _buf = (char*)aligned_alloc(PAGE_SIZE, size);
+            if (!_buf) BLAZE_DIE("Inline read: cannot allocate ", size, " bytes");
+            _buf_size = size;
+        }
+    }
+
+ private:
+    IoBackend                   _backend;
+    aio_context_t               _ctx;
+    uint32_t                    _depth;         // most reads in a round
+    IoUring                     _ring;
+    std::vector<int>            _slot_fds;      // file in each fixed slot
+    std::vector<unsigned>       _read_slots;    // by read of the round
+    char*                       _buf;
+    uint64_t                    _buf_size;
+    std::vector<struct iocb>    _iocb;
+    std::vector<struct iocb*>   _iocbs;
+    std::vector<struct io_event> _events;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_INLINE_READER_H
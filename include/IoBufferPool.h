@@ -0,0 +1,281 @@
+#ifndef BLAZE_IO_BUFFER_POOL_H
+#define BLAZE_IO_BUFFER_POOL_H
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include "Type.h"
+#include "Util.h"
+#include "Param.h"
+#include "Wait.h"
+#include "Numa.h"
+
+namespace blaze {
+
+#define IO_MAX_REG_BUFFER_SIZE  (1ULL * GB)
+#define IO_BUFFER_MAX_CLASSES   24
+
+/*
+ * Per-IO-worker arena of IO buffers with a slab of IoItems, one per page.
+ * Buffers come in size classes: class 0 is a chunk, large enough for the
+ * largest read request, and each further class halves it down to a page,
+ * so a read holds a buffer of at most twice its size. A buffer is handed
+ * out as the item of its first page.
+ *
+ * Every class has a lock-free free list. The IO worker pops buffers and
+ * splits a larger free one when its class is empty; compute workers push
+ * them back after processing. When no free buffer is large enough the IO
+ * worker merges free buddies again. An allocation that fails is the
+ * backpressure on the IO worker.
+ */
+class IoBufferPool {
+ public:
+    IoBufferPool(int disk_id, uint64_t buffer_size, uint64_t chunk_size)
+        :   _chunk_size(chunk_size), _num_releases(0), _merged_at(0)
+    {
+        _num_chunks = buffer_size / chunk_size;
+        BLAZE_ASSERT(_num_chunks > 0, "IO buffer is smaller than a single request");
+        BLAZE_ASSERT(chunk_size % PAGE_SIZE == 0, "IO request size is not a multiple of the page size");
+
+        allocArena(_num_chunks * _chunk_size);
+
+        // halve while both halves stay page aligned
+        uint64_t units_per_chunk = _chunk_size / PAGE_SIZE;
+        _num_classes = 1;
+        while (_num_classes < IO_BUFFER_MAX_CLASSES && (units_per_chunk >> (_num_classes - 1)) % 2 == 0) {
+            _num_classes++;
+        }
+        for (int c = 0; c < _num_classes; c++) {
+            _class_units[c] = units_per_chunk >> c;
+            _heads[c] = pack(0, EMPTY);
+        }
+
+        _num_units = _num_chunks * units_per_chunk;
+        _items = (IoItem*)calloc(_num_units, sizeof(IoItem));
+        _next = new uint32_t [_num_units];
+        _class = new uint8_t [_num_units];
+
+        uint64_t chunks_per_reg = IO_MAX_REG_BUFFER_SIZE / _chunk_size;
+        for (uint64_t i = 0; i < _num_units; i++) {
+            new (&_items[i]) IoItem(disk_id, 0, 0, _base + i * PAGE_SIZE);
+            _items[i].pool = this;
+            _items[i].buf_index = i / units_per_chunk / chunks_per_reg;
+        }
+        for (uint64_t i = _num_units; i > 0; i -= units_per_chunk) {
+            push(0, i - units_per_chunk);
+        }
+        _free_units = _num_units;
+    }
+
+    ~IoBufferPool() {
+        munmap(_base, _arena_size);
+        free(_items);
+        delete [] _next;
+        delete [] _class;
+    }
+
+    // A buffer of at least bytes, at most a chunk; called by the IO worker.
+    // Returns nullptr when no free buffer is large enough.
+    IoItem* alloc(uint64_t bytes) {
+        int c = classOf(bytes);
+        uint32_t idx = pop(c);
+        if (idx == EMPTY)
+            idx = split(c);
+        // buddies may have come back since the last merge
+        if (idx == EMPTY && getFreeUnits() >= _class_units[c]) {
+            uint64_t releases = _num_releases.load(std::memory_order_relaxed);
+            if (releases != _merged_at) {
+                _merged_at = releases;
+                merge();
+                idx = split(c);
+            }
+        }
+        if (idx == EMPTY)
+            return nullptr;
+
+        _class[idx] = c;
+        _free_units.fetch_sub(_class_units[c], std::memory_order_relaxed);
+        return &_items[idx];
+    }
+
+    void release(IoItem* item) {
+        uint32_t idx = item - _items;
+        // a clipped read-ahead item may point into its buffer
+        item->buf = _base + (uint64_t)idx * PAGE_SIZE;
+        int c = _class[idx];
+        push(c, idx);
+        _free_units.fetch_add(_class_units[c], std::memory_order_relaxed);
+        _num_releases.fetch_add(1, std::memory_order_relaxed);
+        _released.notify_all();
+    }
+
+    // The IO worker parks here while no buffer is free
+    Parking* getParking() {
+        return &_released;
+    }
+
+    uint64_t getChunkSize() const {
+        return _chunk_size;
+    }
+
+    // Chunks the arena holds, that is reads of the largest size
+    uint64_t getNumChunks() const {
+        return _num_chunks;
+    }
+
+    uint64_t getFreeBytes() const {
+        return getFreeUnits() * PAGE_SIZE;
+    }
+
+    // Arena split into pieces that io_uring accepts as registered buffers
+    std::vector<struct iovec> getIovecs() const {
+        std::vector<struct iovec> iovs;
+        uint64_t chunks_per_reg = IO_MAX_REG_BUFFER_SIZE / _chunk_size;
+        for (uint64_t i = 0; i < _num_chunks; i += chunks_per_reg) {
+            uint64_t num = std::min(chunks_per_reg, _num_chunks - i);
+            struct iovec iov;
+            iov.iov_base = _base + i * _chunk_size;
+            iov.iov_len = num * _chunk_size;
+            iovs.push_back(iov);
+        }
+        return iovs;
+    }
+
+    // Migrate the arena; registered buffers may stay pinned where they are
+    bool moveToNode(int node) {
+        return numaBindToNode(_base, _arena_size, node, true);
+    }
+
+    bool isHugePageBacked() const {
+        return _huge;
+    }
+
+ private:
+    void allocArena(uint64_t len) {
+        // explicit hugepages first, transparent hugepages as a fallback
+        _arena_size = ALIGN_UPTO(len, HUGE_PAGE_SIZE);
+        _base = (char*)mmap(nullptr, _arena_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        _huge = (_base != MAP_FAILED);
+        if (!_huge) {
+            _base = (char*)mmap(nullptr, _arena_size, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (_base == MAP_FAILED) BLAZE_SYS_DIE("Failed to allocate IO buffer");
+            madvise(_base, _arena_size, MADV_HUGEPAGE);
+        }
+        // prefault so that the first round does not pay for it
+        for (uint64_t pos = 0; pos < _arena_size; pos += PAGE_SIZE) {
+            _base[pos] = 0;
+        }
+    }
+
+    // Smallest class that holds bytes
+    int classOf(uint64_t bytes) const {
+        assert(bytes <= _chunk_size);
+        int c = 0;
+        while (c + 1 < _num_classes && _class_units[c + 1] * PAGE_SIZE >= bytes) {
+            c++;
+        }
+        return c;
+    }
+
+    uint64_t getFreeUnits() const {
+        return _free_units.load(std::memory_order_relaxed);
+    }
+
+    void push(int c, uint32_t idx) {
+        _class[idx] = c;
+        uint64_t head = _heads[c].load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            _next[idx] = index_of(head);
+            new_head = pack(tag_of(head) + 1, idx);
+        } while (!_heads[c].compare_exchange_weak(head, new_head, std::memory_order_acq_rel));
+    }
+
+    // Only the IO worker pops, while compute workers may push
+    uint32_t pop(int c) {
+        uint64_t head = _heads[c].load(std::memory_order_acquire);
+        uint64_t new_head;
+        uint32_t idx;
+        do {
+            idx = index_of(head);
+            if (idx == EMPTY) return EMPTY;
+            new_head = pack(tag_of(head) + 1, _next[idx]);
+        } while (!_heads[c].compare_exchange_weak(head, new_head, std::memory_order_acq_rel));
+        return idx;
+    }
+
+    // Halve the smallest free buffer larger than class c down to it;
+    // the upper halves go to the free lists on the way
+    uint32_t split(int c) {
+        for (int from = c; from >= 0; from--) {
+            uint32_t idx = pop(from);
+            if (idx == EMPTY)
+                continue;
+            while (from < c) {
+                from++;
+                push(from, idx + _class_units[from]);
+            }
+            return idx;
+        }
+        return EMPTY;
+    }
+
+    // Take every free buffer off the lists, smallest class first, and
+    // join buddies; buffers of a class start at a multiple of its size
+    void merge() {
+        std::vector<uint32_t> joined;
+        for (int c = _num_classes - 1; c > 0; c--) {
+            std::vector<uint32_t> bufs;
+            bufs.swap(joined);
+            for (uint32_t idx = pop(c); idx != EMPTY; idx = pop(c)) {
+                bufs.push_back(idx);
+            }
+            std::sort(bufs.begin(), bufs.end());
+
+            uint64_t units = _class_units[c];
+            for (size_t i = 0; i < bufs.size(); i++) {
+                if (i + 1 < bufs.size() && bufs[i] % (2 * units) == 0 && bufs[i + 1] == bufs[i] + units) {
+                    joined.push_back(bufs[i++]);
+                } else {
+                    push(c, bufs[i]);
+                }
+            }
+        }
+        for (uint32_t idx : joined) {
+            push(0, idx);
+        }
+    }
+
+    static uint64_t pack(uint32_t tag, uint32_t idx) { return ((uint64_t)tag << 32) | idx; }
+    static uint32_t tag_of(uint64_t v) { return v >> 32; }
+    static uint32_t index_of(uint64_t v) { return (uint32_t)v; }
+
+    static const uint32_t EMPTY = UINT32_MAX;
+
+ private:
+    char*                   _base;
+    uint64_t                _arena_size;
+    bool                    _huge;
+    uint64_t                _chunk_size;
+    uint64_t                _num_chunks;
+    uint64_t                _num_units;     // pages
+    int                     _num_classes;
+    uint64_t                _class_units[IO_BUFFER_MAX_CLASSES];
+    IoItem*                 _items;         // by first page of the buffer
+    uint32_t*               _next;
+    uint8_t*                _class;         // of the buffer starting at a page
+    // tagged index of the first free buffer of each class (tag avoids ABA)
+    std::atomic<uint64_t>   _heads[IO_BUFFER_MAX_CLASSES];
+    std::atomic<uint64_t>   _free_units;
+    std::atomic<uint64_t>   _num_releases;
+    uint64_t                _merged_at;     // _num_releases at the last merge
+    Parking                 _released;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_IO_BUFFER_POOL_H
@@ -7,10 +7,13 @@
 #include "Graph.h"
 #include "IoWorker.h"
 #include "IoScheduler.h"
+#include "PageCache.h"
 #include "IoSync.h"
 #include "Synchronization.h"
 #include "Queue.h"
 #include "Param.h"
+#include "Config.h"
+#include "WorkerPool.h"
 
 using namespace std;
 
@@ -21,69 +24,153 @@ class IoEngine {
     IoEngine(int num_io_workers,
              int num_compute_workers,
              uint64_t io_buffer_size,
-             std::vector<MPMCQueue<IoItem*>*>& out)
+             std::vector<MPMCQueue<IoItem*>*>& out,
+             WorkerPool& thread_pool,
+             const Config& config)
         :   _num_workers(num_io_workers),
             _num_compute_workers(num_compute_workers),
+            _pipeline(config.io_pipeline),
+            _cache_size(config.cache_size),
+            _cache_policy(config.cache_policy),
+            _io_stats(config.io_stats),
+            _speculate(config.io_speculate),
+            _speculating(false),
+            _pinned{nullptr, nullptr},
+            _num_disks(0),
             _frontier(nullptr),
-            _sparse_page_frontier(nullptr),
+            _sparse_page_frontier{nullptr, nullptr},
             _out(out),
-            _thread_pool(galois::substrate::getThreadPool())
+            _thread_pool(thread_pool)
     {
         uint64_t io_buf_per_worker = io_buffer_size / num_io_workers;
+        uint64_t cache_per_worker = _cache_size / num_io_workers;
         for (int i = 0; i < num_io_workers; i++) {
-            _workers.push_back(new IoWorker(i, io_buf_per_worker, out[i]));
+            _workers.push_back(new IoWorker(i, io_buf_per_worker, cache_per_worker, out, config));
         }
     }
 
     ~IoEngine() {
+        finishSpeculation();
         for (auto worker : _workers) {
             delete worker;
         }
+        for (auto& it : _pinned_pages) {
+            for (auto bitmap : it.second) {
+                delete bitmap;
+            }
+        }
     }
 
-    void setFrontier(Worklist<VID>* frontier, std::vector<CountableBag<PAGEID>*>& sparse_page_frontier) {
+    // A fused edgeMap also gives the sparse page frontier of its in-graph
+    void setFrontier(Worklist<VID>* frontier, std::vector<PageList*>& sparse_page_frontier,
+                     std::vector<PageList*>* in_sparse_page_frontier = nullptr) {
         _frontier = frontier;
-        _sparse_page_frontier = &sparse_page_frontier;
+        _sparse_page_frontier[0] = &sparse_page_frontier;
+        _sparse_page_frontier[1] = in_sparse_page_frontier;
+    }
+
+    // The dense page frontier is then built by run() through IoScheduler
+    bool pipelinesDenseFrontier() const {
+        return _pipeline;
     }
 
     int getWorkerTID(int idx) {
         return 1 + _num_compute_workers + idx;
     }
 
+    // With in_graph, the pages of both graphs are read in one go and
+    // tagged with their graph for the compute workers (fused edgeMap)
     template <typename Gr>
-    double run(Gr& graph, Synchronization& sync, IoSync& io_sync) {
+    double run(Gr& graph, Synchronization& sync, IoSync& io_sync, Gr* in_graph = nullptr) {
         auto time_start = std::chrono::steady_clock::now();
 
         bool dense_all = (_frontier == nullptr);
+        bool pipelined = _pipeline && !dense_all && _frontier->is_dense() && !in_graph;
 
-        for (int i = 0; i < _num_workers; i++) {
-            int fd = graph.GetEdgeFileDescriptor(i);
-            Bitmap* page_bitmap = graph.GetActivatedPages(i);
-            function<void(void)> f = bind(&IoWorker::run,
-                                        _workers[i],
-                                        fd,
-                                        dense_all,
-                                        page_bitmap,
-                                        _sparse_page_frontier->size() ? (*_sparse_page_frontier)[i] : nullptr,
-                                        std::ref(sync),
-                                        std::ref(io_sync));
-            _thread_pool.fork(getWorkerTID(i), f);
+        _num_disks = graph.NumberOfDisks();
+        if (in_graph)
+            _num_disks = std::max(_num_disks, in_graph->NumberOfDisks());
+
+        finishSpeculation();
+
+        // without the scheduler every page is final from the beginning
+        if (!pipelined) {
+            for (int i = 0; i < _num_disks; i++) {
+                uint64_t num_pages = i < graph.NumberOfDisks() ? graph.GetNumPages(i) : 0;
+                if (in_graph && i < in_graph->NumberOfDisks())
+                    num_pages = std::max(num_pages, in_graph->GetNumPages(i));
+                io_sync.update_pos(i, num_pages);
+            }
         }
 
+        _jobs.assign(_num_workers, std::vector<IoJob>());
+        assignJobs(graph, 0);
+        if (in_graph)
+            assignJobs(*in_graph, 1);
+
+        IoWorker** workers = _workers.data();
+        std::vector<IoJob>* jobs = _jobs.data();
+        _thread_pool.fork(getWorkerTID(0), _num_workers, [workers, jobs, dense_all, &sync, &io_sync](int i) {
+            workers[i]->run(jobs[i], dense_all, sync, io_sync);
+        });
+
         sync.notify_io_start();
 
-        for (int i = 0; i < _num_workers; i++) {
-            _thread_pool.join(getWorkerTID(i));
-        }
+        if (pipelined)
+            _scheduler.run(graph, _frontier, sync, io_sync);
+
+        _thread_pool.join(getWorkerTID(0));
 
         sync.mark_io_done();
 
         auto time_end = std::chrono::steady_clock::now();
         std::chrono::duration<double> duration = time_end - time_start;
 
+        // sparse frontiers rarely repeat; after a bad guess skip one round
+        bool sparse = !_sparse_page_frontier[0]->empty();
+        uint64_t ahead = getTotalBytesSpeculated();
+        bool bad_guess = ahead && getTotalBytesSpeculatedUsed() < ahead * IO_SPECULATE_MIN_USE;
+        if (_speculate && !sparse && !bad_guess)
+            startSpeculation(dense_all);
+
         return duration.count();
     }
 
+    // Stop reading ahead and keep what has been read for the next round
+    void finishSpeculation() {
+        if (!_speculating)
+            return;
+        for (auto worker : _workers) {
+            worker->stopSpeculation();
+        }
+        _thread_pool.join(getWorkerTID(0));
+        _speculating = false;
+        for (auto worker : _workers) {
+            worker->endSpeculation();
+        }
+    }
+
+    bool isSpeculationEnabled() const {
+        return _speculate;
+    }
+
+    // Bytes read ahead for the last round and how many of them it used
+    uint64_t getTotalBytesSpeculated() const {
+        uint64_t sum = 0;
+        for (auto worker : _workers) {
+            sum += worker->getBytesSpeculated();
+        }
+        return sum;
+    }
+
+    uint64_t getTotalBytesSpeculatedUsed() const {
+        uint64_t sum = 0;
+        for (auto worker : _workers) {
+            sum += worker->getBytesSpeculatedUsed();
+        }
+        return sum;
+    }
+
     uint64_t getTotalBytesAccessed() const {
         uint64_t sum = 0;
         for (int i = 0; i < _num_workers; ++i) {
@@ -92,61 +179,307 @@ class IoEngine {
         return sum;
     }
 
+    // Bytes read from edge file idx in the last round
+    uint64_t getDeviceBytesAccessed(int idx) const {
+        uint64_t sum = 0;
+        for (auto& jobs : _jobs) {
+            for (auto& job : jobs) {
+                if (job.disk_id == idx)
+                    sum += job.bytes_accessed;
+            }
+        }
+        return sum;
+    }
+
+    int getNumberOfDevices() const {
+        return _num_disks;
+    }
+
+    uint64_t getTotalBytesCached() const {
+        uint64_t sum = 0;
+        for (int i = 0; i < _num_workers; ++i) {
+            sum += _workers[i]->getBytesCached();
+        }
+        return sum;
+    }
+
+    bool isCacheEnabled() const {
+        return _cache_size > 0;
+    }
+
+    // A cached copy of page ppid of edge file fd for an edgeMap run inline,
+    // which runs while the IO workers are idle
+    const char* findCachedPage(int fd, PAGEID ppid) {
+        if (!_cache_size)
+            return nullptr;
+        for (auto worker : _workers) {
+            const char* page = worker->findCached(fd, ppid);
+            if (page)
+                return page;
+        }
+        return nullptr;
+    }
+
+    bool isStatsEnabled() const {
+        return _io_stats;
+    }
+
+    // Machine-readable statistics of the last round, one JSON object per line
+    void printIoStats(int round) const {
+        for (int d = 0; d < _num_disks; d++) {
+            LatencyHistogram latency;
+            for (auto worker : _workers) {
+                auto& worker_latency = worker->getLatency();
+                if (d < (int)worker_latency.size())
+                    latency.merge(worker_latency[d]);
+            }
+            printf("# IOSTAT       : {\"round\":%d,\"device\":%d,\"requests\":%lu,\"mean_us\":%.2f,"
+                   "\"p50_us\":%.2f,\"p90_us\":%.2f,\"p99_us\":%.2f,\"p999_us\":%.2f,\"max_us\":%.2f,\"histogram_us\":",
+                   round, d, latency.getCount(), latency.getMean() / 1e3,
+                   latency.getPercentile(0.5) / 1e3, latency.getPercentile(0.9) / 1e3,
+                   latency.getPercentile(0.99) / 1e3, latency.getPercentile(0.999) / 1e3,
+                   latency.getMax() / 1e3);
+            latency.printBuckets(stdout, 1e3);
+            printf("}\n");
+        }
+        for (int i = 0; i < _num_workers; i++) {
+            const IoTimeline& timeline = _workers[i]->getTimeline();
+            printf("# IOSTAT       : {\"round\":%d,\"worker\":%d,\"buffer_wait_sec\":%.6f,\"interval_us\":%lu,"
+                   "\"timeline_fields\":[\"time_us\",\"in_flight\",\"free_pages\"],\"timeline\":[", round, i, _workers[i]->getBufferWaitTime(), timeline.getIntervalUs());
+            bool first = true;
+            for (auto& sample : timeline.getSamples()) {
+                printf("%s[%u,%u,%lu]", first ? "" : ",", sample.time_us, sample.in_flight, sample.free_pages);
+                first = false;
+            }
+            printf("]}\n");
+        }
+    }
+
+    uint64_t getTotalBytesWasted() const {
+        uint64_t sum = 0;
+        for (int i = 0; i < _num_workers; ++i) {
+            sum += _workers[i]->getBytesWasted();
+        }
+        return sum;
+    }
+
     void initState() {
         for (int i = 0; i < _num_workers; ++i) {
             _workers[i]->initState();
         }
     }
 
+    // Ratio of the most to the fewest bytes read from a disk; 0 when only
+    // some disks were read, which has no ratio
     double getSkewness() const {
         uint64_t min_bytes = UINT64_MAX;
         uint64_t max_bytes = 0;
 
-        for (int i = 0; i < _num_workers; ++i) {
-            uint64_t bytes = _workers[i]->getBytesAccessed();
+        for (int i = 0; i < _num_disks; ++i) {
+            uint64_t bytes = getDeviceBytesAccessed(i);
 
             if (bytes < min_bytes)
                 min_bytes = bytes;
             if (bytes > max_bytes)
                 max_bytes = bytes;
         }
+        // nothing read, e.g. every page was cached or read ahead
+        if (!max_bytes)
+            return 1.0;
+        if (!min_bytes)
+            return 0.0;
         return (double)max_bytes / min_bytes;
     }
 
     void printStat() const {
-        uint64_t min_bytes = UINT64_MAX;
-        uint64_t max_bytes = 0;
         uint64_t sum_bytes = 0;
 
         std::cout << "        io:  ";
-        for (int i = 0; i < _num_workers; ++i) {
+        for (int i = 0; i < _num_disks; ++i) {
             if (i != 0)
                 std::cout << " + ";
-            uint64_t bytes = _workers[i]->getBytesAccessed();
+            uint64_t bytes = getDeviceBytesAccessed(i);
             std::cout << bytes;
-
-            if (bytes < min_bytes)
-                min_bytes = bytes;
-            if (bytes > max_bytes)
-                max_bytes = bytes;
-
             sum_bytes += bytes;
         }
-        double gap = (double)max_bytes / min_bytes;
+        double gap = getSkewness();
         std::cout << " = " << sum_bytes;
-        std::cout << " (" << std::fixed << std::setprecision(2) << gap << ")";
+        if (gap > 0.0)
+            std::cout << " (" << std::fixed << std::setprecision(2) << gap << ")";
+        else
+            std::cout << " (n/a)";
         std::cout << std::endl;
     }
 
+    // Called before workers are forked since it may run parallel loops
+    template <typename Gr>
+    void attachCache(Gr& graph, Gr* in_graph = nullptr) {
+        _pinned[0] = pinnedPages(graph);
+        _pinned[1] = in_graph ? pinnedPages(*in_graph) : nullptr;
+    }
+
+ private:
+    // IO workers read the start of this round's pages again on their pool
+    // threads, which are idle until the next round, while compute finishes
+    // and the next round is prepared by the Galois pool.
+    void startSpeculation(bool dense_all) {
+        bool planned = false;
+        for (int i = 0; i < _num_workers; i++) {
+            _workers[i]->planSpeculation(_jobs[i], dense_all);
+            planned |= _workers[i]->hasSpeculationPlan();
+        }
+        if (!planned)
+            return;
+        IoWorker** workers = _workers.data();
+        _thread_pool.fork(getWorkerTID(0), _num_workers, [workers](int i) {
+            if (workers[i]->hasSpeculationPlan())
+                workers[i]->speculate();
+        });
+        _speculating = true;
+    }
+
+    // Map IO workers to edge files. With at least as many workers as files
+    // worker i serves file i % num_disks and the workers of a file split its
+    // pages into contiguous ranges; otherwise file i is served by worker
+    // i % num_workers, one file after another.
+    // The jobs of the in-graph of a fused edgeMap follow those of the
+    // out-graph on the same workers.
+    template <typename Gr>
+    void assignJobs(Gr& graph, int tag) {
+        std::vector<PageList*>& sparse_page_frontier = *_sparse_page_frontier[tag];
+        std::vector<Bitmap*>* pinned = _pinned[tag];
+        int num_disks = graph.NumberOfDisks();
+
+        bool sparse = !sparse_page_frontier.empty();
+        for (int disk_id = 0; disk_id < num_disks; disk_id++) {
+            IoJob job;
+            job.disk_id = disk_id;
+            job.graph = tag;
+            job.fd = graph.GetEdgeFileDescriptor(disk_id);
+            job.num_pages = graph.GetNumPages(disk_id);
+            job.block_size = graph.GetBlockSize();
+            job.page_bitmap = graph.GetActivatedPages(disk_id);
+            job.pages = sparse ? sparse_page_frontier[disk_id] : nullptr;
+            job.bytes_accessed = 0;
+
+            uint64_t len = sparse ? job.pages->size() : job.num_pages;
+            if (_num_workers <= num_disks) {
+                job.pinned = pinned ? (*pinned)[disk_id] : nullptr;
+                job.beg = 0;
+                job.end = len;
+                _jobs[disk_id % _num_workers].push_back(job);
+                continue;
+            }
+
+            int num_shares = numShares(disk_id, num_disks);
+            for (int k = 0; k < num_shares; k++) {
+                int worker = disk_id + k * num_disks;
+                job.pinned = pinned ? (*pinned)[worker] : nullptr;
+                if (sparse) {
+                    job.beg = len * k / num_shares;
+                    job.end = len * (k + 1) / num_shares;
+                } else {
+                    denseShare(len, k, num_shares, &job.beg, &job.end);
+                }
+                _jobs[worker].push_back(job);
+            }
+        }
+    }
+
+    // Workers of a file when there are more workers than files
+    int numShares(int disk_id, int num_disks) const {
+        return (_num_workers - disk_id - 1) / num_disks + 1;
+    }
+
+    // Page range k of num_shares of a file in a dense round; ranges start
+    // at a bitmap word
+    static void denseShare(uint64_t len, int k, int num_shares, uint64_t* beg, uint64_t* end) {
+        *beg = k ? ALIGN_UPTO(len * k / num_shares, 64) : 0;
+        *end = k + 1 < num_shares ? ALIGN_UPTO(len * (k + 1) / num_shares, 64) : len;
+        *beg = std::min(*beg, len);
+        *end = std::min(*end, len);
+    }
+
+    // CACHE_PIN: hub pages of the graph, selected once per graph, as many
+    // as the cache of the worker reading them holds. A worker serving
+    // several files shares its cache among them. Graphs are told apart by
+    // the descriptor of their first edge file.
+    // Pins are by file, or by worker when the workers of a file split it:
+    // sparse rounds split a file by position in the page list, and a
+    // worker only caches the pins of its dense range.
+    template <typename Gr>
+    std::vector<Bitmap*>* pinnedPages(Gr& graph) {
+        if (!_cache_size || _cache_policy != CACHE_PIN)
+            return nullptr;
+
+        int key = graph.GetEdgeFileDescriptor(0);
+        auto it = _pinned_pages.find(key);
+        if (it != _pinned_pages.end())
+            return &it->second;
+
+        int num_disks = graph.NumberOfDisks();
+        uint64_t pages_per_cache = _cache_size / _num_workers / graph.GetBlockSize();
+        if (_num_workers <= num_disks) {
+            auto owner = [&](int disk_id, PAGEID pid) {
+                return disk_id % _num_workers;
+            };
+            it = _pinned_pages.emplace(key, selectHubPages(graph, _num_workers, pages_per_cache, owner)).first;
+            return &it->second;
+        }
+
+        auto owner = [&](int disk_id, PAGEID pid) {
+            int num_shares = numShares(disk_id, num_disks);
+            uint64_t len = graph.GetNumPages(disk_id);
+            uint64_t beg, end;
+            int k = 0;
+            for (; k + 1 < num_shares; k++) {
+                denseShare(len, k, num_shares, &beg, &end);
+                if (pid < end)
+                    break;
+            }
+            return disk_id + k * num_disks;
+        };
+        std::vector<Bitmap*> by_disk = selectHubPages(graph, _num_workers, pages_per_cache, owner);
+
+        std::vector<Bitmap*> by_worker;
+        for (int worker = 0; worker < _num_workers; worker++) {
+            int disk_id = worker % num_disks;
+            uint64_t len = graph.GetNumPages(disk_id);
+            uint64_t beg, end;
+            denseShare(len, worker / num_disks, numShares(disk_id, num_disks), &beg, &end);
+            Bitmap* pinned = new Bitmap(len);
+            for (uint64_t pid = beg; pid < end; pid++) {
+                if (by_disk[disk_id]->get_bit(pid))
+                    pinned->set_bit(pid);
+            }
+            by_worker.push_back(pinned);
+        }
+        for (auto bitmap : by_disk) {
+            delete bitmap;
+        }
+        it = _pinned_pages.emplace(key, by_worker).first;
+        return &it->second;
+    }
+
  private:
     int                                 _num_workers;
     int                                 _num_compute_workers;
+    bool                                _pipeline;
+    uint64_t                            _cache_size;
+    CachePolicy                         _cache_policy;
+    bool                                _io_stats;
+    bool                                _speculate;
+    bool                                _speculating;
+    std::unordered_map<int, std::vector<Bitmap*>>  _pinned_pages;
+    std::vector<Bitmap*>*               _pinned[2];     // by graph tag
+    int                                 _num_disks;
     vector<IoWorker*>                   _workers;
+    std::vector<std::vector<IoJob>>     _jobs;          // per worker
     IoScheduler                         _scheduler;
     Worklist<VID>*                      _frontier;
-    std::vector<CountableBag<PAGEID>*>* _sparse_page_frontier;
+    std::vector<PageList*>*             _sparse_page_frontier[2];
     std::vector<MPMCQueue<IoItem*>*>&   _out;
-    galois::substrate::ThreadPool&      _thread_pool;
+    WorkerPool&                         _thread_pool;
 };
 
 } // namespace blaze
@@ -0,0 +1,207 @@
+#ifndef BLAZE_IO_PROBE_H
+#define BLAZE_IO_PROBE_H
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AsyncIo.h"
+#include "IoStats.h"
+#include "Util.h"
+#include "Param.h"
+
+namespace blaze {
+
+struct IoProbeResult {
+    uint32_t    queue_depth;
+    uint32_t    request_size;
+    double      bandwidth;      // bytes/sec over all files
+    double      p99_us;         // worst file
+};
+
+/*
+ * Startup probe of the edge files. Every candidate pair of queue depth
+ * and request size is run for IO_PROBE_DURATION_MS with random reads on
+ * all files at once, the way IO workers load the devices. Among the pairs
+ * whose p99 latency stays under IO_PROBE_MAX_P99_US (all of them if none
+ * does), the one with the fewest bytes in flight within
+ * IO_PROBE_BANDWIDTH_SLACK of the best bandwidth wins.
+ *
+ * The probe always uses aio; the result holds for io_uring as well since
+ * both drive the same device queue.
+ */
+class IoProbe {
+ public:
+    IoProbe(const std::vector<std::string>& files): _files(files) {}
+
+    IoProbeResult run() {
+        std::vector<IoProbeResult> results;
+        for (uint32_t depth = IO_PROBE_MIN_DEPTH; depth <= IO_PROBE_MAX_DEPTH; depth *= 2) {
+            for (uint32_t size = PAGE_SIZE; size <= IO_MAX_REQ_SIZE; size *= 4) {
+                results.push_back(measure(depth, size));
+            }
+        }
+
+        bool any_fast = false;
+        for (auto& result : results) {
+            any_fast |= result.p99_us <= IO_PROBE_MAX_P99_US;
+        }
+        auto acceptable = [&](const IoProbeResult& result) {
+            return !any_fast || result.p99_us <= IO_PROBE_MAX_P99_US;
+        };
+
+        double best_bandwidth = 0.0;
+        for (auto& result : results) {
+            if (acceptable(result))
+                best_bandwidth = std::max(best_bandwidth, result.bandwidth);
+        }
+
+        IoProbeResult chosen = results.back();
+        uint64_t chosen_bytes_in_flight = UINT64_MAX;
+        for (auto& result : results) {
+            if (!acceptable(result)) continue;
+            if (result.bandwidth < best_bandwidth * (1.0 - IO_PROBE_BANDWIDTH_SLACK)) continue;
+            uint64_t bytes_in_flight = (uint64_t)result.queue_depth * result.request_size;
+            if (bytes_in_flight < chosen_bytes_in_flight) {
+                chosen = result;
+                chosen_bytes_in_flight = bytes_in_flight;
+            }
+        }
+        return chosen;
+    }
+
+    // Values cached by an earlier probe of the same files, as long as they
+    // still sit on the same devices with the same size and mtime
+    static bool load(const std::string& path, const std::vector<std::string>& files, IoProbeResult* result) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string key, files_line;
+        std::getline(in, files_line);
+        if (files_line != filesKey(files)) return false;
+        in >> key >> result->queue_depth
+           >> key >> result->request_size
+           >> key >> result->bandwidth
+           >> key >> result->p99_us;
+        return (bool)in && result->queue_depth > 0 && result->request_size >= PAGE_SIZE;
+    }
+
+    static void save(const std::string& path, const std::vector<std::string>& files, const IoProbeResult& result) {
+        std::ofstream out(path);
+        if (!out) {
+            printf("IO probe: cannot write %s\n", path.c_str());
+            return;
+        }
+        out << filesKey(files) << "\n"
+            << "queue_depth " << result.queue_depth << "\n"
+            << "request_size " << result.request_size << "\n"
+            << "bandwidth " << result.bandwidth << "\n"
+            << "p99_us " << result.p99_us << "\n";
+    }
+
+ private:
+    static std::string filesKey(const std::vector<std::string>& files) {
+        std::string key = "files";
+        for (auto& file : files) {
+            struct stat st;
+            if (stat(file.c_str(), &st) < 0)
+                memset(&st, 0, sizeof(st));
+            key += " " + file + ":" + std::to_string((uint64_t)st.st_dev)
+                 + ":" + std::to_string((uint64_t)st.st_size)
+                 + ":" + std::to_string((uint64_t)st.st_mtim.tv_sec)
+                 + "." + std::to_string((uint64_t)st.st_mtim.tv_nsec);
+        }
+        return key;
+    }
+
+    IoProbeResult measure(uint32_t depth, uint32_t size) {
+        std::vector<uint64_t> bytes(_files.size(), 0);
+        std::vector<LatencyHistogram> latency(_files.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < _files.size(); i++) {
+            threads.emplace_back(&IoProbe::measureFile, this, std::ref(_files[i]),
+                                 depth, size, std::ref(bytes[i]), std::ref(latency[i]));
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        IoProbeResult result = { depth, size, 0.0, 0.0 };
+        for (size_t i = 0; i < _files.size(); i++) {
+            result.bandwidth += bytes[i] / (IO_PROBE_DURATION_MS / 1e3);
+            result.p99_us = std::max(result.p99_us, latency[i].getPercentile(0.99) / 1e3);
+        }
+        return result;
+    }
+
+    // Keep depth random reads of size in flight until the time is up
+    void measureFile(const std::string& file, uint32_t depth, uint32_t size,
+                     uint64_t& bytes, LatencyHistogram& latency) {
+        int fd = open(file.c_str(), O_RDONLY | O_DIRECT);
+        if (fd < 0) fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) BLAZE_SYS_DIE("IO probe: cannot open ", file);
+        uint64_t num_blocks = file_size(file) / size;
+        if (num_blocks == 0) {
+            close(fd);
+            return;
+        }
+
+        aio_context_t ctx = 0;
+        if (io_setup(depth, &ctx)) BLAZE_SYS_DIE("IO probe: io_setup failed");
+        char* buf = (char*)aligned_alloc(PAGE_SIZE, (uint64_t)depth * size);
+        std::vector<struct iocb> iocbs(depth);
+        std::vector<struct iocb*> iocbps(depth);
+        std::vector<struct io_event> events(depth);
+        std::vector<uint64_t> submitted(depth);
+        std::mt19937_64 rng(fd * 7919 + depth + size);
+
+        auto submit = [&](uint32_t slot) {
+            struct iocb* cb = &iocbs[slot];
+            memset(cb, 0, sizeof(*cb));
+            cb->aio_fildes = fd;
+            cb->aio_lio_opcode = IOCB_CMD_PREAD;
+            cb->aio_buf = (uint64_t)(buf + (uint64_t)slot * size);
+            cb->aio_nbytes = size;
+            cb->aio_offset = (rng() % num_blocks) * size;
+            cb->aio_data = slot;
+            submitted[slot] = nowInNsec();
+            iocbps[0] = cb;
+            return io_submit(ctx, 1, iocbps.data()) == 1;
+        };
+
+        uint32_t in_flight = 0;
+        for (uint32_t slot = 0; slot < depth; slot++) {
+            in_flight += submit(slot);
+        }
+
+        uint64_t end = nowInNsec() + IO_PROBE_DURATION_MS * 1000000UL;
+        while (in_flight) {
+            int received = io_getevents(ctx, 1, depth, events.data(), NULL);
+            if (received <= 0) break;
+            uint64_t now = nowInNsec();
+            for (int i = 0; i < received; i++) {
+                uint32_t slot = events[i].data;
+                in_flight--;
+                if (events[i].res > 0) bytes += events[i].res;
+                latency.record(now - submitted[slot]);
+                if (now < end) in_flight += submit(slot);
+            }
+        }
+
+        io_destroy(ctx);
+        free(buf);
+        close(fd);
+    }
+
+ private:
+    std::vector<std::string>    _files;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_IO_PROBE_H
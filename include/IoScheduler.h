@@ -11,6 +11,13 @@
 
 namespace blaze {
 
+/*
+ * Translates a dense vertex frontier into per-disk page bitmaps in vertex
+ * order while the IO workers are already running. Vertices are laid out
+ * in order on disk, so every page below the last page touched on a disk
+ * is final; that position is published through IoSync as the watermark
+ * up to which the IO worker of the disk may read.
+ */
 class IoScheduler {
  public:
     IoScheduler() {}
@@ -32,13 +39,14 @@ class IoScheduler {
             page_bitmaps.push_back(graph.GetActivatedPages(disk_id));
         }
 
-        int latest_pid[num_disks];
+        PAGEID latest_pid[num_disks];
+        PAGEID published_pid[num_disks];
         for (disk_id = 0; disk_id < num_disks; disk_id++) {
             latest_pid[disk_id] = 0;
+            published_pid[disk_id] = 0;
         }
 
         uint64_t n = graph.NumberOfNodes();
-        int num_disks_bit = (int)log2((float)num_disks);
 
         Bitmap* fbitmap = frontier->get_dense();
         uint64_t num_words = fbitmap->get_num_words();
@@ -57,8 +65,7 @@ class IoScheduler {
 
                     graph.GetPageRange(vid, &pid, &pid_end);
                     while (pid <= pid_end) {
-                        disk_id = pid % num_disks;
-                        pid_in_disk = pid >> num_disks_bit;
+                        graph.GetPageLocation(pid, &disk_id, &pid_in_disk);
                         page_bitmaps[disk_id]->set_bit(pid_in_disk);
                         latest_pid[disk_id] = pid_in_disk;
                         pid++;
@@ -66,8 +73,13 @@ class IoScheduler {
                 }
             }
 
+            // publishing wakes parked IO workers, so only do it when the
+            // watermark of a disk actually moved
             for (disk_id = 0; disk_id < num_disks; disk_id++) {
-                io_sync.update_pos(disk_id, latest_pid[disk_id]);
+                if (latest_pid[disk_id] != published_pid[disk_id]) {
+                    io_sync.update_pos(disk_id, latest_pid[disk_id]);
+                    published_pid[disk_id] = latest_pid[disk_id];
+                }
             }
         }
 
@@ -0,0 +1,170 @@
+#ifndef BLAZE_IO_STATS_H
+#define BLAZE_IO_STATS_H
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "Param.h"
+
+namespace blaze {
+
+inline uint64_t nowInNsec() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Log-linear latency histogram in the style of HdrHistogram. Values below
+ * 2^LATENCY_SUB_BITS are exact; above that every power of two is split
+ * into 2^LATENCY_SUB_BITS buckets, so the relative error stays below
+ * 1 / 2^LATENCY_SUB_BITS.
+ */
+class LatencyHistogram {
+ public:
+    static const int num_sub = 1 << LATENCY_SUB_BITS;
+    static const int num_buckets = (64 - LATENCY_SUB_BITS + 1) * num_sub;
+
+    LatencyHistogram() {
+        reset();
+    }
+
+    void reset() {
+        for (int i = 0; i < num_buckets; i++) {
+            _counts[i] = 0;
+        }
+        _count = 0;
+        _sum = 0;
+        _max = 0;
+    }
+
+    void record(uint64_t value) {
+        _counts[bucketOf(value)]++;
+        _count++;
+        _sum += value;
+        if (value > _max) _max = value;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < num_buckets; i++) {
+            _counts[i] += other._counts[i];
+        }
+        _count += other._count;
+        _sum += other._sum;
+        if (other._max > _max) _max = other._max;
+    }
+
+    uint64_t getCount() const {
+        return _count;
+    }
+
+    uint64_t getMax() const {
+        return _max;
+    }
+
+    double getMean() const {
+        return _count ? (double)_sum / _count : 0.0;
+    }
+
+    // Upper bound of the bucket holding the p-th quantile (0 < p <= 1)
+    uint64_t getPercentile(double p) const {
+        uint64_t target = (uint64_t)(p * _count + 0.5);
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < num_buckets; i++) {
+            seen += _counts[i];
+            if (seen >= target)
+                return std::min(upperOf(i) - 1, _max);
+        }
+        return _max;
+    }
+
+    // Non-empty buckets as [upper bound in unit, count] pairs
+    void printBuckets(FILE* fp, double unit) const {
+        bool first = true;
+        fprintf(fp, "[");
+        for (int i = 0; i < num_buckets; i++) {
+            if (!_counts[i]) continue;
+            fprintf(fp, "%s[%.3f,%lu]", first ? "" : ",", upperOf(i) / unit, _counts[i]);
+            first = false;
+        }
+        fprintf(fp, "]");
+    }
+
+ private:
+    static int bucketOf(uint64_t value) {
+        if (value < (uint64_t)num_sub) return value;
+        int msb = 63 - __builtin_clzll(value);
+        int exp = msb - LATENCY_SUB_BITS + 1;
+        int mantissa = (value >> (msb - LATENCY_SUB_BITS)) & (num_sub - 1);
+        return exp * num_sub + mantissa;
+    }
+
+    static uint64_t upperOf(int bucket) {
+        int exp = bucket / num_sub;
+        uint64_t mantissa = bucket % num_sub;
+        if (exp == 0) return mantissa + 1;
+        return (num_sub + mantissa + 1) << (exp - 1);
+    }
+
+ private:
+    uint64_t    _counts[num_buckets];
+    uint64_t    _count;
+    uint64_t    _sum;
+    uint64_t    _max;
+};
+
+/*
+ * Requests in flight and free IO buffer pages of one IO worker, sampled
+ * every interval while it runs. When the sample buffer is full every
+ * other sample is dropped and the interval doubles.
+ */
+class IoTimeline {
+ public:
+    struct Sample {
+        uint32_t    time_us;
+        uint32_t    in_flight;
+        uint64_t    free_pages;
+    };
+
+    IoTimeline(): _start(0), _next(0), _interval(IO_TIMELINE_INTERVAL_US * 1000) {
+        _samples.reserve(IO_TIMELINE_MAX_SAMPLES);
+    }
+
+    void start(uint64_t now) {
+        _samples.clear();
+        _start = now;
+        _next = now;
+        _interval = IO_TIMELINE_INTERVAL_US * 1000;
+    }
+
+    void sample(uint64_t now, uint32_t in_flight, uint64_t free_pages) {
+        if (now < _next) return;
+        if (_samples.size() == IO_TIMELINE_MAX_SAMPLES) {
+            for (size_t i = 0; i < _samples.size() / 2; i++) {
+                _samples[i] = _samples[2 * i];
+            }
+            _samples.resize(_samples.size() / 2);
+            _interval *= 2;
+        }
+        _samples.push_back({ (uint32_t)((now - _start) / 1000), in_flight, free_pages });
+        _next = now + _interval;
+    }
+
+    uint64_t getIntervalUs() const {
+        return _interval / 1000;
+    }
+
+    const std::vector<Sample>& getSamples() const {
+        return _samples;
+    }
+
+ private:
+    uint64_t                _start;
+    uint64_t                _next;
+    uint64_t                _interval;
+    std::vector<Sample>     _samples;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_IO_STATS_H
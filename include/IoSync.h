@@ -4,32 +4,50 @@
 #include <vector>
 #include <atomic>
 //#include "Type.h"
+#include "Wait.h"
 
 namespace blaze {
 
 class IoSync {
  public:
-    IoSync(int num_disks) {
-        _pos = new std::atomic<uint64_t> [num_disks];
-        for (int i = 0; i < num_disks; i++) {
-            atomic_store(&_pos[i], (uint64_t)0);
-        }
+    IoSync(int num_disks = 0): _pos(nullptr), _num_disks(0) {
+        reset(num_disks);
     }
 
     ~IoSync() {
         delete [] _pos;
     }
 
+    // Reused across rounds: every watermark back to 0
+    void reset(int num_disks) {
+        if (num_disks > _num_disks) {
+            delete [] _pos;
+            _pos = new std::atomic<uint64_t> [num_disks];
+            _num_disks = num_disks;
+        }
+        for (int i = 0; i < _num_disks; i++) {
+            atomic_store(&_pos[i], (uint64_t)0);
+        }
+    }
+
+    // Raise the watermark and wake IO workers parked below it
     void update_pos(int idx, uint64_t pos) {
         atomic_store(&_pos[idx], pos);
+        _parking.notify_all();
     }
 
     uint64_t get_pos(int idx) {
         return atomic_load(&_pos[idx]);
     }
 
+    Parking* getParking() {
+        return &_parking;
+    }
+
  private:
     std::atomic<uint64_t>*  _pos;
+    int                     _num_disks;
+    Parking                 _parking;
 };
 
 } // namespace blaze
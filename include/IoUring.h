@@ -0,0 +1,319 @@
+#ifndef BLAZE_IO_URING_H
+#define BLAZE_IO_URING_H
+
+#include <errno.h>
+#include <unistd.h>
+#include <vector>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "Util.h"
+
+namespace blaze {
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+#define IO_URING_MAX_FILES      16
+#define IO_URING_SQ_IDLE_MS     2000
+
+/*
+ * Minimal io_uring wrapper driven by a single IO thread.
+ * Completions are reaped from the shared CQ ring without a syscall,
+ * submissions are skipped entirely while the SQPOLL thread is awake.
+ */
+class IoUring {
+ public:
+    IoUring()
+        :   _ring_fd(-1), _flags(0),
+            _sq_ptr(nullptr), _sq_len(0), _cq_ptr(nullptr), _cq_len(0),
+            _sqes(nullptr), _sqes_len(0),
+            _sq_tail_local(0), _sq_submitted(0),
+            _num_prepped(0), _num_reported(0)
+    {}
+
+    ~IoUring() {
+        deinit();
+    }
+
+    void init(unsigned entries, bool sqpoll, bool iopoll) {
+        struct io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 2;
+        if (sqpoll) {
+            p.flags |= IORING_SETUP_SQPOLL;
+            p.sq_thread_idle = IO_URING_SQ_IDLE_MS;
+        }
+        if (iopoll) {
+            p.flags |= IORING_SETUP_IOPOLL;
+        }
+
+        _ring_fd = io_uring_setup(entries, &p);
+        if (_ring_fd < 0) BLAZE_SYS_DIE("io_uring_setup failed");
+        _flags = p.flags;
+
+        _sq_len = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        _cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            _sq_len = _cq_len = std::max(_sq_len, _cq_len);
+        }
+
+        _sq_ptr = (char*)mmap(0, _sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              _ring_fd, IORING_OFF_SQ_RING);
+        if (_sq_ptr == MAP_FAILED) BLAZE_SYS_DIE("io_uring sq ring mmap failed");
+
+        if (single_mmap) {
+            _cq_ptr = _sq_ptr;
+        } else {
+            _cq_ptr = (char*)mmap(0, _cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  _ring_fd, IORING_OFF_CQ_RING);
+            if (_cq_ptr == MAP_FAILED) BLAZE_SYS_DIE("io_uring cq ring mmap failed");
+        }
+
+        _sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+        _sqes = (struct io_uring_sqe*)mmap(0, _sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                           _ring_fd, IORING_OFF_SQES);
+        if (_sqes == MAP_FAILED) BLAZE_SYS_DIE("io_uring sqes mmap failed");
+
+        _sq_head = (unsigned*)(_sq_ptr + p.sq_off.head);
+        _sq_tail = (unsigned*)(_sq_ptr + p.sq_off.tail);
+        _sq_mask = *(unsigned*)(_sq_ptr + p.sq_off.ring_mask);
+        _sq_entries = *(unsigned*)(_sq_ptr + p.sq_off.ring_entries);
+        _sq_flags = (unsigned*)(_sq_ptr + p.sq_off.flags);
+        _sq_array = (unsigned*)(_sq_ptr + p.sq_off.array);
+
+        _cq_head = (unsigned*)(_cq_ptr + p.cq_off.head);
+        _cq_tail = (unsigned*)(_cq_ptr + p.cq_off.tail);
+        _cq_mask = *(unsigned*)(_cq_ptr + p.cq_off.ring_mask);
+        _cqes = (struct io_uring_cqe*)(_cq_ptr + p.cq_off.cqes);
+
+        // one request slot per completion the CQ ring can hold
+        _reqs.resize(p.cq_entries);
+        _free_reqs.clear();
+        for (unsigned i = 0; i < p.cq_entries; i++) {
+            _free_reqs.push_back(p.cq_entries - 1 - i);
+        }
+
+        // identity mapping between sq array slots and sqes
+        for (unsigned i = 0; i < _sq_entries; i++) {
+            _sq_array[i] = i;
+        }
+        _sq_tail_local = _sq_submitted = *_sq_tail;
+
+        // sparse fixed file table, filled by updateFile()
+        int fds[IO_URING_MAX_FILES];
+        for (int i = 0; i < IO_URING_MAX_FILES; i++) {
+            fds[i] = -1;
+        }
+        int ret = io_uring_register(_ring_fd, IORING_REGISTER_FILES, fds, IO_URING_MAX_FILES);
+        if (ret < 0) BLAZE_SYS_DIE("io_uring file registration failed");
+    }
+
+    void deinit() {
+        if (_ring_fd < 0) return;
+        munmap(_sqes, _sqes_len);
+        if (_cq_ptr != _sq_ptr)
+            munmap(_cq_ptr, _cq_len);
+        munmap(_sq_ptr, _sq_len);
+        close(_ring_fd);
+        _ring_fd = -1;
+    }
+
+    // Point the fixed file slot at fd
+    void updateFile(unsigned slot, int fd) {
+        assert(slot < IO_URING_MAX_FILES);
+        struct io_uring_files_update up;
+        memset(&up, 0, sizeof(up));
+        up.offset = slot;
+        up.fds = (uint64_t)&fd;
+        int ret = io_uring_register(_ring_fd, IORING_REGISTER_FILES_UPDATE, &up, 1);
+        if (ret < 0) BLAZE_SYS_DIE("io_uring file update failed");
+    }
+
+    // Pin buffers so that reads can use READ_FIXED.
+    // Fails softly (e.g. RLIMIT_MEMLOCK); callers then use plain reads.
+    bool registerBuffers(const struct iovec* iov, unsigned num) {
+        int ret = io_uring_register(_ring_fd, IORING_REGISTER_BUFFERS, iov, num);
+        return ret == 0;
+    }
+
+    unsigned getQueueDepth() const {
+        return _sq_entries;
+    }
+
+    // Queue a read on a fixed file slot. buf_index < 0 means an unregistered buffer.
+    void prepRead(unsigned file_slot, char* buf, uint32_t len, off_t offset, int buf_index, void* data) {
+        assert(!_free_reqs.empty());
+        unsigned slot = _free_reqs.back();
+        _free_reqs.pop_back();
+        Request& req = _reqs[slot];
+        req.data = data;
+        req.buf = buf;
+        req.len = len;
+        req.offset = offset;
+        req.file_slot = file_slot;
+        req.buf_index = buf_index;
+        queueRead(req, slot);
+        _num_prepped++;
+    }
+
+    // Publish queued sqes. Returns the number of reads queued by prepRead
+    // since the last call, including those reap() already pushed out.
+    unsigned submit() {
+        publish();
+        unsigned submitted = _num_prepped - _num_reported;
+        _num_reported = _num_prepped;
+        return submitted;
+    }
+
+    // Block until at least one completion is in the CQ ring
+    void waitCompletion() {
+        publish();
+        io_uring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+    }
+
+    // Reap up to max completed reads in one pass over the CQ ring.
+    // A short read is requeued for its remaining bytes and only returned
+    // once the whole buffer is filled.
+    unsigned reap(void** datas, unsigned max) {
+        if ((_flags & IORING_SETUP_IOPOLL) && !(_flags & IORING_SETUP_SQPOLL)) {
+            // polled completions are only found when we ask for them
+            io_uring_enter(_ring_fd, 0, 0, IORING_ENTER_GETEVENTS);
+        }
+
+        unsigned head = *_cq_head;
+        unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        bool requeued = false;
+
+        while (head != tail && count < max) {
+            struct io_uring_cqe* cqe = &_cqes[head & _cq_mask];
+            unsigned slot = (unsigned)cqe->user_data;
+            Request& req = _reqs[slot];
+            if (cqe->res < 0) {
+                errno = -cqe->res;
+                BLAZE_SYS_DIE("io_uring read failed");
+            }
+            if (cqe->res == 0) {
+                BLAZE_DIE("io_uring read returned no data at offset ", req.offset);
+            }
+            if ((uint32_t)cqe->res < req.len) {
+                req.buf += cqe->res;
+                req.offset += cqe->res;
+                req.len -= cqe->res;
+                queueRead(req, slot);
+                requeued = true;
+            } else {
+                datas[count++] = req.data;
+                _free_reqs.push_back(slot);
+            }
+            head++;
+        }
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+
+        if (requeued || _sq_submitted != _sq_tail_local) publish();
+
+        return count;
+    }
+
+ private:
+    struct Request {
+        void*       data;
+        char*       buf;
+        uint32_t    len;
+        off_t       offset;
+        unsigned    file_slot;
+        int         buf_index;
+    };
+
+    void queueRead(const Request& req, unsigned slot) {
+        struct io_uring_sqe* sqe = &_sqes[_sq_tail_local & _sq_mask];
+        memset(sqe, 0, sizeof(*sqe));
+        if (req.buf_index >= 0) {
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->buf_index = req.buf_index;
+        } else {
+            sqe->opcode = IORING_OP_READ;
+        }
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = req.file_slot;
+        sqe->addr = (uint64_t)req.buf;
+        sqe->len = req.len;
+        sqe->off = req.offset;
+        sqe->user_data = slot;
+        _sq_tail_local++;
+    }
+
+    void publish() {
+        unsigned to_submit = _sq_tail_local - _sq_submitted;
+        if (!to_submit) return;
+
+        __atomic_store_n(_sq_tail, _sq_tail_local, __ATOMIC_RELEASE);
+
+        if (_flags & IORING_SETUP_SQPOLL) {
+            // the kernel thread picks sqes up by itself unless it went idle
+            if (__atomic_load_n(_sq_flags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP)
+                io_uring_enter(_ring_fd, to_submit, 0, IORING_ENTER_SQ_WAKEUP);
+            _sq_submitted = _sq_tail_local;
+            return;
+        }
+
+        // the kernel may consume fewer sqes than asked for; whatever is
+        // left over goes out on the next call
+        while (_sq_submitted != _sq_tail_local) {
+            int ret = io_uring_enter(_ring_fd, _sq_tail_local - _sq_submitted, 0, 0);
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EBUSY) break;
+                BLAZE_SYS_DIE("io_uring_enter failed");
+            }
+            if (ret == 0) break;
+            _sq_submitted += ret;
+        }
+    }
+
+    int                     _ring_fd;
+    unsigned                _flags;
+    char*                   _sq_ptr;
+    size_t                  _sq_len;
+    char*                   _cq_ptr;
+    size_t                  _cq_len;
+    struct io_uring_sqe*    _sqes;
+    size_t                  _sqes_len;
+    // sq ring
+    unsigned*               _sq_head;
+    unsigned*               _sq_tail;
+    unsigned*               _sq_flags;
+    unsigned*               _sq_array;
+    unsigned                _sq_mask;
+    unsigned                _sq_entries;
+    unsigned                _sq_tail_local;
+    unsigned                _sq_submitted;
+    // cq ring
+    unsigned*               _cq_head;
+    unsigned*               _cq_tail;
+    unsigned                _cq_mask;
+    struct io_uring_cqe*    _cqes;
+    // reads in flight, indexed by sqe user_data
+    std::vector<Request>    _reqs;
+    std::vector<unsigned>   _free_reqs;
+    unsigned                _num_prepped;
+    unsigned                _num_reported;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_IO_URING_H
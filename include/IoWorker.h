@@ -8,174 +8,499 @@
 #include "IoSync.h"
 #include "Synchronization.h"
 #include "AsyncIo.h"
+#include "IoUring.h"
+#include "IoBufferPool.h"
+#include "PageCache.h"
+#include "Config.h"
+#include "Wait.h"
+#include "Numa.h"
+#include "IoStats.h"
 #include "Queue.h"
 #include "Param.h"
+#include <atomic>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace blaze {
 
 class Runtime;
 
+/*
+ * A contiguous part of one edge file read by an IO worker in a round.
+ * [beg, end) are page ids in dense rounds and positions in pages in
+ * sparse rounds.
+ */
+struct IoJob {
+    int         disk_id;
+    int         graph;              // tag given to the fetched pages, see IoItem
+    int         fd;
+    uint64_t    num_pages;          // of the whole edge file
+    uint32_t    block_size;         // bytes per page of the graph
+    Bitmap*     page_bitmap;
+    PageList*   pages;              // sparse rounds only
+    Bitmap*     pinned;             // CACHE_PIN only
+    uint64_t    beg;
+    uint64_t    end;
+    uint64_t    bytes_accessed;     // filled in by the worker
+};
+
+// A read of a speculation, planned from the jobs of the round before
+struct SpecRead {
+    int         disk_id;
+    int         fd;
+    uint32_t    block_size;
+    PAGEID      page;
+    uint32_t    num;
+};
+
 class IoWorker {
  public:
     IoWorker(int id,
              uint64_t buffer_size,
-             MPMCQueue<IoItem*>* out)
+             uint64_t cache_size,
+             std::vector<MPMCQueue<IoItem*>*>& out,
+             const Config& config)
         :   _id(id),
             _buffered_tasks(out),
+            _next_queue(id % out.size()),
+            _config(config),
+            _backend(config.io_backend),
+            _disk_id(-1), _fd(-1), _graph(0), _job_page_beg(0), _job_page_end(0), _registered_fd(-1), _fixed_buffers(false),
             _queued(0), _sent(0), _received(0), _requested_all(false),
-            _total_bytes_accessed(0), _time(0.0)
+            _cache(nullptr), _numa_fd(-1), _buffer_wait_ns(0),
+            _speculating(false), _stop_speculation(false),
+            _spec_bytes_read(0), _spec_bytes_ahead(0), _spec_bytes_used(0),
+            _total_bytes_accessed(0), _total_bytes_wasted(0), _total_bytes_cached(0), _time(0.0)
     {
-        initAsyncIo();
-        _num_buffer_pages = (int64_t)buffer_size / PAGE_SIZE;
+        _request_size = config.io_request_size;
+        _block_size = PAGE_SIZE;
+        _max_pages_per_req = _request_size / _block_size;
+        _queue_depth = config.io_queue_depth;
+        _done_tasks.resize(_queue_depth);
+        _gap_pages = 0;
+        _pool = new IoBufferPool(id, buffer_size, _request_size);
+        if (cache_size)
+            _cache = new PageCache(cache_size, config.cache_policy);
+        initAsyncIo(config);
     }
 
     ~IoWorker() {
         deinitAsyncIo();
+        delete _pool;
+        delete _cache;
     }
 
-    void initAsyncIo() {
+    void initAsyncIo(const Config& config) {
+        if (_backend == IO_BACKEND_URING) {
+            _ring.init(_queue_depth, config.io_sqpoll, config.io_iopoll);
+            auto iovs = _pool->getIovecs();
+            _fixed_buffers = _ring.registerBuffers(iovs.data(), iovs.size());
+            if (!_fixed_buffers)
+                printf("IO worker %d: buffer registration failed, using plain reads\n", _id);
+            return;
+        }
         _ctx = 0;
-        int ret = io_setup(IO_QUEUE_DEPTH, &_ctx);
+        int ret = io_setup(_queue_depth, &_ctx);
         assert(ret == 0);
-        _iocb = (struct iocb*)calloc(IO_QUEUE_DEPTH, sizeof(*_iocb));
-        _iocbs = (struct iocb**)calloc(IO_QUEUE_DEPTH, sizeof(*_iocbs));
-        _events = (struct io_event*)calloc(IO_QUEUE_DEPTH, sizeof(*_events));
+        _iocb = (struct iocb*)calloc(_queue_depth, sizeof(*_iocb));
+        _iocbs = (struct iocb**)calloc(_queue_depth, sizeof(*_iocbs));
+        _events = (struct io_event*)calloc(_queue_depth, sizeof(*_events));
     }
 
     void deinitAsyncIo() {
+        if (_backend == IO_BACKEND_URING) {
+            _ring.deinit();
+            return;
+        }
         io_destroy(_ctx);
         free(_iocb);
         free(_iocbs);
         free(_events);
     }
 
-    void run(int fd, bool dense_all, Bitmap* page_bitmap, CountableBag<PAGEID>* sparse_page_frontier,
-            Synchronization& sync, IoSync& io_sync) {
-        _fd = fd;
-        sync.set_num_free_pages(_id, _num_buffer_pages);
+    // Jobs are read one after another; each is drained before the next
+    // starts since the registered file of io_uring is switched between them.
+    void run(std::vector<IoJob>& jobs, bool dense_all, Synchronization& sync, IoSync& io_sync) {
+        if (_config.numa && !jobs.empty())
+            followDevice(jobs[0].fd);
+        if (_config.io_stats)
+            _timeline.start(nowInNsec());
+
+        for (auto& job : jobs) {
+            uint64_t bytes_accessed = _total_bytes_accessed;
+            startJob(job);
+
+            if (dense_all) {
+                run_dense_all(job.beg, job.end, sync, io_sync);
+
+            } else if (job.pages) {
+                run_sparse(*job.pages, job.beg, job.end, sync, io_sync);
 
-        if (dense_all) {
-            run_dense_all(page_bitmap, sync, io_sync);
+            } else {
+                run_dense(job.page_bitmap, job.beg, job.end, sync, io_sync);
+            }
+
+            job.bytes_accessed = _total_bytes_accessed - bytes_accessed;
         }
 
-        if (sparse_page_frontier) {
-            run_sparse(sparse_page_frontier, page_bitmap, sync, io_sync);
+        discardPrefetched();
+    }
 
-        } else {
-            run_dense(page_bitmap, sync, io_sync);
+    // Pick the first pages of this round's dense jobs, up to a share of the
+    // buffers, to be read again for the next round. Called by the IO engine
+    // before speculate() runs since the page bitmaps are reset after a round.
+    void planSpeculation(const std::vector<IoJob>& jobs, bool dense_all) {
+        _spec_plan.clear();
+        // in bytes, now that a read holds a buffer of about its size
+        uint64_t budget = _pool->getNumChunks() * _pool->getChunkSize() * IO_SPECULATE_BUFFER_RATIO;
+        uint64_t planned = 0;
+        for (auto& job : jobs) {
+            uint32_t max_pages = _request_size / job.block_size;
+            Bitmap* page_bitmap = job.page_bitmap;
+            PAGEID pid = job.beg;
+            while (pid < job.end && planned < budget) {
+                if (!dense_all && !page_bitmap->get_word(Bitmap::word_offset(pid))) {
+                    pid = Bitmap::pos_in_next_word(pid);
+                    continue;
+                }
+                if (!dense_all && !page_bitmap->get_bit(pid)) {
+                    pid++;
+                    continue;
+                }
+                SpecRead read = { job.disk_id, job.fd, job.block_size, pid, 1 };
+                pid++;
+                while (pid < job.end && read.num < max_pages && (dense_all || page_bitmap->get_bit(pid))) {
+                    read.num++;
+                    pid++;
+                }
+                _spec_plan.push_back(read);
+                planned += (uint64_t)read.num * job.block_size;
+            }
+        }
+    }
+
+    bool hasSpeculationPlan() const {
+        return !_spec_plan.empty();
+    }
+
+    // Runs on a thread of its own between rounds: read the planned pages
+    // into spare buffers until done or told to stop. Completed reads wait
+    // in _prefetched for the next run().
+    void speculate() {
+        IoItem** done_tasks = _done_tasks.data();
+        size_t next = 0;
+
+        _speculating = true;
+        _requested_all = false;
+        Parking* parking = _pool->getParking();
+        while (true) {
+            bool stop = _stop_speculation.load();
+            uint64_t queued = _queued;
+            uint32_t seq = parking->sequence();
+            while (!stop && next < _spec_plan.size() && canEnqueue()) {
+                const SpecRead& read = _spec_plan[next];
+                if (read.fd != _fd) {
+                    // files are switched with nothing in flight, as between jobs
+                    if (_received < _queued) break;
+                    selectFile(read.disk_id, read.fd);
+                }
+                IoItem* item = allocItem((uint64_t)read.num * read.block_size);
+                if (!item) break;
+                item->page = read.page;
+                item->num = read.num;
+                item->num_fillers = 0;
+                enqueueRequest(item, (uint64_t)read.num * read.block_size, (uint64_t)read.page * read.block_size);
+                next++;
+            }
+            submitRequests();
+
+            if ((stop || next == _spec_plan.size()) && _received == _queued)
+                break;
+
+            int received = receiveTasks(done_tasks, _queued == queued);
+            for (int i = 0; i < received; i++) {
+                addPrefetched(done_tasks[i]);
+            }
+
+            // the buffers are taken by the round still computing; wake up
+            // when one comes back, unless one did since the last attempt
+            if (_queued == queued && !received)
+                parking->park(seq, WAIT_PARK_TIMEOUT_US);
+        }
+        _speculating = false;
+        _spec_plan.clear();
+    }
+
+    void stopSpeculation() {
+        _stop_speculation = true;
+        _pool->getParking()->notify_all();
+    }
+
+    // After speculate() has returned
+    void endSpeculation() {
+        _stop_speculation = false;
+        _spec_bytes_ahead += _spec_bytes_read;
+        _spec_bytes_read = 0;
+    }
+
+    // Read ahead for the last round by the speculation before it
+    uint64_t getBytesSpeculated() const {
+        return _spec_bytes_ahead;
+    }
+
+    // Of those, bytes the last round needed
+    uint64_t getBytesSpeculatedUsed() const {
+        return _spec_bytes_used;
+    }
+
+    // Release read-ahead pages no round has taken
+    void discardPrefetched() {
+        for (auto& it : _prefetched_items) {
+            int fd = it.first;
+            IoItem* item = it.second;
+            if (!_prefetched.count(prefetchKey(fd, item->page)))
+                continue;
+            for (uint32_t i = 0; i < item->num; i++) {
+                _prefetched.erase(prefetchKey(fd, item->page + i));
+            }
+            item->pool->release(item);
         }
+        _prefetched_items.clear();
+        _prefetched.clear();
     }
 
     uint64_t getBytesAccessed() const {
         return _total_bytes_accessed;
     }
 
+    uint64_t getBytesWasted() const {
+        return _total_bytes_wasted;
+    }
+
+    uint64_t getBytesCached() const {
+        return _total_bytes_cached;
+    }
+
+    // A page of edge file fd in the cache of this worker, or nullptr
+    const char* findCached(int fd, PAGEID page_id) {
+        return _cache ? _cache->find(fd, page_id) : nullptr;
+    }
+
+    // Statistics only: a speculation may already be reading for the next round
     void initState() {
-        _queued = 0;
-        _sent = 0;
-        _received = 0;
-        _requested_all = false;
         _total_bytes_accessed = 0;
+        _total_bytes_wasted = 0;
+        _total_bytes_cached = 0;
         _time = 0;
+        for (auto& latency : _latency) {
+            latency.reset();
+        }
+        _buffer_wait_ns = 0;
+        _spec_bytes_ahead = 0;
+        _spec_bytes_used = 0;
+    }
+
+    // Read latencies of the last round in ns, indexed by disk
+    const std::vector<LatencyHistogram>& getLatency() const {
+        return _latency;
+    }
+
+    const IoTimeline& getTimeline() const {
+        return _timeline;
+    }
+
+    // Time spent waiting for free buffers in the last round
+    double getBufferWaitTime() const {
+        return _buffer_wait_ns / 1e9;
     }
 
  private:
-    void run_dense_all(Bitmap* page_bitmap, Synchronization& sync, IoSync& io_sync) {
-        IoItem* done_tasks[IO_QUEUE_DEPTH];
+    // Run on the node of the device read first, and keep the buffers there
+    void followDevice(int fd) {
+        if (fd == _numa_fd) return;
+        _numa_fd = fd;
+
+        NumaTopology& topology = NumaTopology::get();
+        int node = topology.getNodeOfFile(fd);
+        if (node < 0) return;
+        topology.pinSelf(galois::substrate::ThreadPool::getTID(), node);
+        _pool->moveToNode(node);
+    }
+
+    void selectFile(int disk_id, int fd) {
+        _disk_id = disk_id;
+        _fd = fd;
+        if (_backend == IO_BACKEND_URING && _fd != _registered_fd) {
+            _ring.updateFile(0, _fd);
+            _registered_fd = _fd;
+        }
+    }
+
+    void startJob(const IoJob& job) {
+        selectFile(job.disk_id, job.fd);
+        _graph = job.graph;
+        if (job.block_size > _request_size)
+            BLAZE_DIE("IO request size (", _request_size / kB, " kB) is smaller than the block size (",
+                      job.block_size / kB, " kB), see -ioRequestSize");
+        _block_size = job.block_size;
+        _max_pages_per_req = _request_size / _block_size;
+        _gap_pages = _config.getGapPages(_disk_id);
+        if (_config.io_stats && (int)_latency.size() <= _disk_id)
+            _latency.resize(_disk_id + 1);
+        if (_cache)
+            _cache->attach(_fd, job.num_pages, job.block_size, job.pinned);
+        _requested_all = false;
+
+        // pages of the file this job owns; sparse jobs split the page list
+        // by position, so their bounds are the pages at those positions
+        if (job.pages) {
+            const PageList& pages = *job.pages;
+            _job_page_beg = job.beg < pages.size() ? pages[job.beg] : job.num_pages;
+            _job_page_end = job.end < pages.size() ? pages[job.end] : job.num_pages;
+        } else {
+            _job_page_beg = job.beg;
+            _job_page_end = job.end;
+        }
+    }
+
+    void run_dense_all(PAGEID beg, const PAGEID end, Synchronization& sync, IoSync& io_sync) {
+        IoItem** done_tasks = _done_tasks.data();
         int received;
 
-        PAGEID beg = 0;
-        const PAGEID end = page_bitmap->get_size();
+        Waiter waiter(WAIT_IO_BUFFER, _pool->getParking());
 
         while (!_requested_all || _received < _queued) {
+            uint64_t queued = _queued;
+            uint64_t cached = _total_bytes_cached;
             submitTasks_dense_all(beg, end, sync, io_sync);
-            received = receiveTasks(done_tasks);
-            dispatchTasks(done_tasks, received);
+            // block for a completion if nothing could be submitted
+            received = receiveTasks(done_tasks, _queued == queued);
+            dispatchTasks(done_tasks, received, sync);
+
+            // neither IO nor cache hits: wait for compute workers to free buffers
+            if (_queued == queued && _total_bytes_cached == cached && !received)
+                waiter.wait();
+            else
+                waiter.done();
         }
+        waiter.done();
+        _buffer_wait_ns += waiter.getTotalNsec();
     }
 
-    void run_dense(Bitmap* page_bitmap, Synchronization& sync, IoSync& io_sync) {
-        IoItem* done_tasks[IO_QUEUE_DEPTH];
+    void run_dense(Bitmap* page_bitmap, PAGEID beg, const PAGEID end,
+                   Synchronization& sync, IoSync& io_sync) {
+        IoItem** done_tasks = _done_tasks.data();
         int received;
 
-        PAGEID beg = 0;
-        const PAGEID end = page_bitmap->get_size();
+        Waiter waiter(WAIT_IO_BUFFER, _pool->getParking());
+        Waiter frontier_waiter(WAIT_IO_FRONTIER, io_sync.getParking());
 
         while (!_requested_all || _received < _queued) {
-            submitTasks_dense(page_bitmap, beg, end, sync, io_sync);
-            received = receiveTasks(done_tasks);
-            dispatchTasks(done_tasks, received);
+            uint64_t queued = _queued;
+            uint64_t cached = _total_bytes_cached;
+            // pages below the watermark of IoSync are final
+            PAGEID ready = std::min((uint64_t)end, io_sync.get_pos(_disk_id));
+            submitTasks_dense(page_bitmap, beg, ready, end, sync, io_sync);
+            // block for a completion if nothing could be submitted
+            received = receiveTasks(done_tasks, _queued == queued);
+            dispatchTasks(done_tasks, received, sync);
+
+            if (_queued != queued || _total_bytes_cached != cached || received) {
+                waiter.done();
+                frontier_waiter.done();
+            } else if (beg >= ready) {
+                // everything below the watermark is requested: wait for IoScheduler
+                waiter.done();
+                frontier_waiter.wait();
+            } else {
+                // wait for compute workers to free buffers
+                frontier_waiter.done();
+                waiter.wait();
+            }
         }
+        waiter.done();
+        frontier_waiter.done();
+        _buffer_wait_ns += waiter.getTotalNsec();
     }
 
-    void run_sparse(CountableBag<PAGEID>* sparse_page_frontier, Bitmap* page_bitmap, Synchronization& sync, IoSync& io_sync) {
-        IoItem* done_tasks[IO_QUEUE_DEPTH];
+    void run_sparse(const PageList& pages, size_t pos, const size_t end,
+                    Synchronization& sync, IoSync& io_sync) {
+        IoItem** done_tasks = _done_tasks.data();
         int received;
 
-        auto beg = sparse_page_frontier->begin();
-        auto const end = sparse_page_frontier->end();
+        Waiter waiter(WAIT_IO_BUFFER, _pool->getParking());
 
         while (!_requested_all || _received < _queued) {
-            submitTasks_sparse(beg, end, page_bitmap, sync, io_sync);
-            received = receiveTasks(done_tasks);
-            dispatchTasks(done_tasks, received);
+            uint64_t queued = _queued;
+            uint64_t cached = _total_bytes_cached;
+            submitTasks_sparse(pages, pos, end, sync, io_sync);
+            // block for a completion if nothing could be submitted
+            received = receiveTasks(done_tasks, _queued == queued);
+            dispatchTasks(done_tasks, received, sync);
+
+            // neither IO nor cache hits: wait for compute workers to free buffers
+            if (_queued == queued && _total_bytes_cached == cached && !received)
+                waiter.wait();
+            else
+                waiter.done();
         }
+        waiter.done();
+        _buffer_wait_ns += waiter.getTotalNsec();
     }
 
     void submitTasks_dense_all(PAGEID& beg, const PAGEID& end,
                             Synchronization& sync, IoSync& io_sync)
     {
-        char* buf;
         off_t offset;
-        void* data;
 
-        while (beg < end && (_queued - _sent) < IO_QUEUE_DEPTH) {
-            // check continuous pages up to 16kB
+        while (beg < end && canEnqueue()) {
+            if (prefetched(beg)) {
+                beg = deliverPrefetched(beg, sync);
+                continue;
+            }
+
+            // read as many pages as a request can hold,
+            // a run of cached pages is served without IO
             PAGEID page_id = beg;
-            uint32_t num_pages = IO_MAX_PAGES_PER_REQ;
-            if (beg + num_pages > end)
-                num_pages = end - beg;
+            bool hit = cached(page_id);
+            uint32_t num_pages = 1;
+            while (page_id + num_pages < end && num_pages < _max_pages_per_req
+                    && cached(page_id + num_pages) == hit && !prefetched(page_id + num_pages))
+            {
+                num_pages++;
+            }
 
-            // wait until free pages are available
-            while (sync.get_num_free_pages(_id) < num_pages) {}
-            sync.add_num_free_pages(_id, (int64_t)num_pages * (-1));
+            IoItem* item = allocItem((uint64_t)num_pages * _block_size);
+            if (!item) break;
+            beg = page_id + num_pages;
 
-            uint32_t len = num_pages * PAGE_SIZE;
-            buf = (char*)aligned_alloc(PAGE_SIZE, len);
-            offset = (uint64_t)page_id * PAGE_SIZE;
-            IoItem* item = new IoItem(_id, page_id, num_pages, buf);
-            enqueueRequest(buf, len, offset, item);
+            if (hit) {
+                serveFromCache(item, page_id, num_pages, sync);
+                continue;
+            }
 
-            beg += num_pages;
+            item->page = page_id;
+            item->num = num_pages;
+            item->num_fillers = 0;
+            offset = (uint64_t)page_id * _block_size;
+            enqueueRequest(item, num_pages * _block_size, offset);
         }
 
         if (beg >= end) _requested_all = true;
 
-        if (_queued - _sent == 0) return;
-
-        for (size_t i = 0; i < _queued - _sent; i++) {
-            _iocbs[i] = &_iocb[(_sent + i) % IO_QUEUE_DEPTH];
-        }
-
-        int ret = io_submit(_ctx, _queued - _sent, _iocbs);
-        if (ret > 0) {
-            _sent += ret;
-        }
+        submitRequests();
     }
 
-    void submitTasks_dense(Bitmap* page_bitmap, PAGEID& beg, const PAGEID& end,
+    void submitTasks_dense(Bitmap* page_bitmap, PAGEID& beg, const PAGEID& ready, const PAGEID& end,
                         Synchronization& sync, IoSync& io_sync)
     {
-        char* buf;
         off_t offset;
-        void* data;
 
-        while (beg < end && (_queued - _sent) < IO_QUEUE_DEPTH) {
+        while (beg < ready && canEnqueue()) {
             // skip an entire word in bitmap if possible
             // note: this is quite effective to keep IO queue busy
             if (!page_bitmap->get_word(Bitmap::word_offset(beg))) {
-                beg = Bitmap::pos_in_next_word(beg);
+                beg = std::min((PAGEID)Bitmap::pos_in_next_word(beg), ready);
                 continue;
             }
 
@@ -183,91 +508,207 @@ class IoWorker {
                 beg++;
                 continue;
 
+            } else if (prefetched(beg)) {
+                beg = deliverPrefetched(beg, sync);
+
             } else {
-                // check continuous pages up to 16kB
                 PAGEID page_id = beg;
+                PAGEID next = beg + 1;
                 uint32_t num_pages = 1;
-                while (page_bitmap->get_bit(++beg)
-                             && beg < end 
-                             && num_pages < IO_MAX_PAGES_PER_REQ)
-                {
-                    num_pages++;
+                uint32_t num_fillers = 0;
+
+                if (cached(page_id)) {
+                    while (next < ready && num_pages < _max_pages_per_req
+                            && page_bitmap->get_bit(next) && cached(next) && !prefetched(next))
+                    {
+                        num_pages++;
+                        next++;
+                    }
+                    IoItem* item = allocItem((uint64_t)num_pages * _block_size);
+                    if (!item) break;
+                    beg = next;
+                    serveFromCache(item, page_id, num_pages, sync);
+                    continue;
+                }
+
+                // merge continuous pages up to the request size,
+                // reading through holes of at most _gap_pages pages
+                while (next < ready && num_pages < _max_pages_per_req) {
+                    if (page_bitmap->get_bit(next)) {
+                        if (cached(next) || prefetched(next)) break;
+                        num_pages++;
+                        next++;
+                        continue;
+                    }
+                    uint32_t hole = 1;
+                    while (hole <= _gap_pages && next + hole < ready
+                            && !page_bitmap->get_bit(next + hole))
+                    {
+                        hole++;
+                    }
+                    if (hole > _gap_pages || next + hole >= ready
+                            || num_pages + hole >= _max_pages_per_req
+                            || cached(next + hole) || prefetched(next + hole))
+                        break;
+                    num_pages += hole + 1;
+                    num_fillers += hole;
+                    next += hole + 1;
                 }
 
-                // wait until free pages are available
-                while (sync.get_num_free_pages(_id) < num_pages) {}
-                sync.add_num_free_pages(_id, (int64_t)num_pages * (-1));
+                IoItem* item = allocItem((uint64_t)num_pages * _block_size);
+                if (!item) break;
+                beg = next;
 
-                uint32_t len = num_pages * PAGE_SIZE;
-                buf = (char*)aligned_alloc(PAGE_SIZE, len);
-                offset = (uint64_t)page_id * PAGE_SIZE;
-                IoItem* item = new IoItem(_id, page_id, num_pages, buf);
-                enqueueRequest(buf, len, offset, item);
+                item->page = page_id;
+                item->num = num_pages;
+                item->num_fillers = num_fillers;
+                _total_bytes_wasted += (uint64_t)num_fillers * _block_size;
+                offset = (uint64_t)page_id * _block_size;
+                enqueueRequest(item, num_pages * _block_size, offset);
             }
         }
 
         if (beg >= end) _requested_all = true;
 
-        if (_queued - _sent == 0) return;
-
-        for (size_t i = 0; i < _queued - _sent; i++) {
-            _iocbs[i] = &_iocb[(_sent + i) % IO_QUEUE_DEPTH];
-        }
-
-        int ret = io_submit(_ctx, _queued - _sent, _iocbs);
-        if (ret > 0) {
-            _sent += ret;
-        }
+        submitRequests();
     }
 
-    void submitTasks_sparse(CountableBag<PAGEID>::iterator& beg,
-                            const CountableBag<PAGEID>::iterator& end,
-                            Bitmap* page_bitmap,
+    void submitTasks_sparse(const PageList& pages, size_t& pos, const size_t end,
                             Synchronization& sync, IoSync& io_sync)
     {
-        char* buf;
         off_t offset;
-        void* data;
-        PAGEID page_id;
 
-        while (beg != end && (_queued - _sent) < IO_QUEUE_DEPTH) {
-            page_id = *beg;
-
-            if (page_bitmap->get_bit(page_id)) {
-                beg++;
+        while (pos < end && canEnqueue()) {
+            if (prefetched(pages[pos])) {
+                PAGEID next = deliverPrefetched(pages[pos], sync);
+                while (pos < end && pages[pos] < next) {
+                    pos++;
+                }
                 continue;
             }
 
-            // wait until free pages are available
-            while (sync.get_num_free_pages(_id) < 1) {}
-            sync.add_num_free_pages(_id, (int64_t)(-1));
+            // pages are sorted and unique, so merge runs of adjacent pages
+            PAGEID page_id = pages[pos];
+            bool hit = cached(page_id);
+            size_t next = pos + 1;
+            uint32_t num_pages = 1;
+            while (next < end && num_pages < _max_pages_per_req
+                    && pages[next] == page_id + num_pages && cached(pages[next]) == hit
+                    && !prefetched(pages[next]))
+            {
+                num_pages++;
+                next++;
+            }
 
-            buf = (char*)aligned_alloc(PAGE_SIZE, PAGE_SIZE);
-            offset = (uint64_t)page_id * PAGE_SIZE;
-            IoItem* item = new IoItem(_id, page_id, 1, buf);
-            enqueueRequest(buf, PAGE_SIZE, offset, item);
+            IoItem* item = allocItem((uint64_t)num_pages * _block_size);
+            if (!item) break;
+            pos = next;
 
-            page_bitmap->set_bit(page_id);
+            if (hit) {
+                serveFromCache(item, page_id, num_pages, sync);
+                continue;
+            }
 
-            beg++;
+            item->page = page_id;
+            item->num = num_pages;
+            item->num_fillers = 0;
+            offset = (uint64_t)page_id * _block_size;
+            enqueueRequest(item, num_pages * _block_size, offset);
         }
 
-        if (beg == end) _requested_all = true;
+        if (pos == end) _requested_all = true;
 
-        if (_queued - _sent == 0) return;
+        submitRequests();
+    }
 
-        for (size_t i = 0; i < _queued - _sent; i++) {
-            _iocbs[i] = &_iocb[(_sent + i) % IO_QUEUE_DEPTH];
+    IoItem* allocItem(uint64_t bytes) {
+        IoItem* item = _pool->alloc(bytes);
+        if (item)
+            item->disk_id = _disk_id;
+        return item;
+    }
+
+    bool cached(PAGEID page_id) const {
+        return _cache && _cache->contains(page_id);
+    }
+
+    // pages of one file stay below 2^48, also with 64-bit page ids
+    static uint64_t prefetchKey(int fd, PAGEID page_id) {
+        return ((uint64_t)fd << 48) | page_id;
+    }
+
+    bool prefetched(PAGEID page_id) const {
+        return !_prefetched.empty() && _prefetched.count(prefetchKey(_fd, page_id));
+    }
+
+    // Every page of a read-ahead request points to it
+    void addPrefetched(IoItem* item) {
+        _prefetched_items.emplace_back(_fd, item);
+        for (uint32_t i = 0; i < item->num; i++) {
+            _prefetched[prefetchKey(_fd, item->page + i)] = item;
         }
+    }
 
-        int ret = io_submit(_ctx, _queued - _sent, _iocbs);
-        if (ret > 0) {
-            _sent += ret;
+    // Hand the read-ahead request holding page_id to compute workers,
+    // clipped to the pages of the current job: other workers of the file
+    // read the rest themselves. Pages inside the job the round does not
+    // need only hold vertices outside the frontier. Returns the page after
+    // the delivered part.
+    PAGEID deliverPrefetched(PAGEID page_id, Synchronization& sync) {
+        IoItem* item = _prefetched[prefetchKey(_fd, page_id)];
+        PAGEID first = item->page;
+        PAGEID next = item->page + item->num;
+        for (PAGEID pid = first; pid < next; pid++) {
+            _prefetched.erase(prefetchKey(_fd, pid));
         }
+        // the pool points buf back at its buffer on release
+        PAGEID beg = std::max(first, _job_page_beg);
+        PAGEID end = std::min(next, _job_page_end);
+        assert(beg <= page_id && page_id < end);
+        item->buf += (uint64_t)(beg - first) * _block_size;
+        item->page = beg;
+        item->num = end - beg;
+        _spec_bytes_used += (uint64_t)item->num * _block_size;
+        next = end;
+        deliver(item);
+        sync.fetched_pages().notify_all();
+        return next;
+    }
+
+    // Hand cached pages to compute workers as if they had been read
+    void serveFromCache(IoItem* item, PAGEID page_id, uint32_t num_pages, Synchronization& sync) {
+        item->page = page_id;
+        item->num = num_pages;
+        item->num_fillers = 0;
+        for (uint32_t i = 0; i < num_pages; i++) {
+            _cache->read(page_id + i, item->buf + (uint64_t)i * _block_size);
+        }
+        _total_bytes_cached += (uint64_t)num_pages * _block_size;
+        deliver(item);
+        sync.fetched_pages().notify_all();
+    }
+
+    bool canEnqueue() const {
+        // io_uring bounds requests in flight, aio bounds unsubmitted iocbs
+        if (_backend == IO_BACKEND_URING)
+            return (_queued - _received) < _queue_depth;
+        return (_queued - _sent) < _queue_depth;
     }
 
-    void enqueueRequest(char* buf, size_t len, off_t offset, void* data) {
-        uint32_t idx = _queued % IO_QUEUE_DEPTH;
+    void enqueueRequest(IoItem* item, size_t len, off_t offset) {
+        char* buf = item->buf;
+        void* data = item;
+        if (_config.io_stats)
+            item->submit_ns = nowInNsec();
+        if (_backend == IO_BACKEND_URING) {
+            _ring.prepRead(0, buf, len, offset, _fixed_buffers ? item->buf_index : -1, data);
+            _queued++;
+            if (_speculating) _spec_bytes_read += len;
+            else              _total_bytes_accessed += len;
+            return;
+        }
+
+        uint32_t idx = _queued % _queue_depth;
         struct iocb* pIocb = &_iocb[idx];
         memset(pIocb, 0, sizeof(*pIocb));
         pIocb->aio_fildes = _fd;
@@ -278,16 +719,56 @@ class IoWorker {
         pIocb->aio_data = (uint64_t)data;
         _queued++;
 
-        _total_bytes_accessed += len;
+        if (_speculating) _spec_bytes_read += len;
+        else              _total_bytes_accessed += len;
+    }
+
+    void submitRequests() {
+        if (_queued - _sent == 0) return;
+
+        if (_backend == IO_BACKEND_URING) {
+            _sent += _ring.submit();
+            return;
+        }
+
+        for (size_t i = 0; i < _queued - _sent; i++) {
+            _iocbs[i] = &_iocb[(_sent + i) % _queue_depth];
+        }
+
+        int ret = io_submit(_ctx, _queued - _sent, _iocbs);
+        if (ret > 0) {
+            _sent += ret;
+        }
     }
 
-    int receiveTasks(IoItem** done_tasks) {
+    int receiveTasks(IoItem** done_tasks, bool block) {
         if (_requested_all && _sent == _received) return 0;
 
-        unsigned min = 0;
-        unsigned max = IO_QUEUE_DEPTH;
+        // only block while requests are in flight
+        block = block && _sent > _received;
+
+        if (_backend == IO_BACKEND_URING) {
+            if (block) {
+                ScopedStall stall(WAIT_IO_COMPLETION);
+                _ring.waitCompletion();
+            }
+            int received = _ring.reap((void**)done_tasks, _queue_depth);
+            _received += received;
+            if (_config.io_stats && !_speculating)
+                recordCompletions(done_tasks, received);
+            return received;
+        }
+
+        unsigned min = block ? 1 : 0;
+        unsigned max = _queue_depth;
 
-        int received = io_getevents(_ctx, min, max, _events, NULL);
+        int received;
+        if (block) {
+            ScopedStall stall(WAIT_IO_COMPLETION);
+            received = io_getevents(_ctx, min, max, _events, NULL);
+        } else {
+            received = io_getevents(_ctx, min, max, _events, NULL);
+        }
         assert(received <= max);
         assert(received >= 0);
 
@@ -297,34 +778,100 @@ class IoWorker {
             done_tasks[i] = item;
         }
         _received += received;
+        if (_config.io_stats && !_speculating)
+            recordCompletions(done_tasks, received);
 
         return received;
     }
 
-    void dispatchTasks(IoItem** done_tasks, int received) {
-        if (received > 0)
-            _buffered_tasks->enqueue_bulk(done_tasks, received);
+    // Latency of completed reads and a timeline sample if one is due
+    void recordCompletions(IoItem** done_tasks, int received) {
+        uint64_t now = nowInNsec();
+        for (int i = 0; i < received; i++) {
+            IoItem* item = done_tasks[i];
+            _latency[item->disk_id].record(now - item->submit_ns);
+        }
+        _timeline.sample(now, _sent - _received, _pool->getFreeBytes() / _block_size);
+    }
+
+    void dispatchTasks(IoItem** done_tasks, int received, Synchronization& sync) {
+        if (_cache) {
+            for (int i = 0; i < received; i++) {
+                IoItem* item = done_tasks[i];
+                for (int j = 0; j < item->num; j++) {
+                    _cache->insert(item->page + j, item->buf + (uint64_t)j * _block_size);
+                }
+            }
+        }
+        if (received > 0) {
+            for (int i = 0; i < received; i++) {
+                deliver(done_tasks[i]);
+            }
+            sync.fetched_pages().notify_all();
+        }
+    }
+
+    // Compute workers' local queues are filled round-robin
+    void deliver(IoItem* item) {
+        item->graph = _graph;
+        _buffered_tasks[_next_queue]->enqueue(item);
+        if (++_next_queue == _buffered_tasks.size())
+            _next_queue = 0;
     }
 
  protected:
     int                     _id;
-    MPMCQueue<IoItem*>*     _buffered_tasks;
+    std::vector<MPMCQueue<IoItem*>*>&   _buffered_tasks;
+    size_t                  _next_queue;
 
     // To control IO
+    Config                  _config;
+    IoBackend               _backend;
+    int                     _disk_id;
     int                     _fd;
+    int                     _graph;             // of the current job
+    PAGEID                  _job_page_beg;      // pages of the current job
+    PAGEID                  _job_page_end;
+    int                     _registered_fd;
+    bool                    _fixed_buffers;
     uint64_t                _queued;
     uint64_t                _sent;
     uint64_t                _received;
     bool                    _requested_all;
-    int64_t                 _num_buffer_pages;
+    IoBufferPool*           _pool;
+    uint32_t                _request_size;
+    uint32_t                _block_size;        // of the current job
+    uint32_t                _max_pages_per_req;
+    uint32_t                _queue_depth;
+    std::vector<IoItem*>    _done_tasks;
+    uint32_t                _gap_pages;
+    PageCache*              _cache;
+    int                     _numa_fd;       // device the worker follows
+    // IO statistics
+    std::vector<LatencyHistogram>   _latency;
+    IoTimeline              _timeline;
+    uint64_t                _buffer_wait_ns;
+    // speculative reads for the next round
+    bool                    _speculating;
+    std::atomic<bool>       _stop_speculation;
+    std::vector<SpecRead>   _spec_plan;
+    std::vector<std::pair<int, IoItem*>>    _prefetched_items;  // with their fd
+    std::unordered_map<uint64_t, IoItem*>   _prefetched;        // by fd and page
+    uint64_t                _spec_bytes_read;       // by the running speculation
+    uint64_t                _spec_bytes_ahead;
+    uint64_t                _spec_bytes_used;
     // For statistics
     uint64_t                _total_bytes_accessed;
+    uint64_t                _total_bytes_wasted;
+    uint64_t                _total_bytes_cached;
     double                  _time;
 
     aio_context_t                       _ctx;
     struct iocb*                        _iocb;
     struct iocb**                       _iocbs;
     struct io_event*                    _events;
+
+    IoUring                             _ring;
 };
 
 } // namespace blaze
@@ -0,0 +1,22 @@
+#ifndef BLAZE_MEM_GRAPH_H
+#define BLAZE_MEM_GRAPH_H
+
+#include "Graph.h"
+
+namespace blaze {
+
+/*
+ * Graph whose edge files are loaded into memory when it is built.
+ * edgeMap on it runs without IO workers, the same as Graph with -inMemory.
+ */
+class MemGraph : public Graph {
+ public:
+    void BuildGraph(const std::string& input_index_file, std::vector<std::string>& input_edge_files) {
+        Graph::BuildGraph(input_index_file, input_edge_files);
+        LoadEdgesInMemory();
+    }
+};
+
+} // namespace blaze
+
+#endif // BLAZE_MEM_GRAPH_H
@@ -0,0 +1,118 @@
+#ifndef BLAZE_MEM_SCHEDULER_H
+#define BLAZE_MEM_SCHEDULER_H
+
+#include <vector>
+#include <atomic>
+#include "Type.h"
+#include "Bitmap.h"
+#include "Param.h"
+
+namespace blaze {
+
+/*
+ * Hands out the edge pages of one edgeMap round to compute workers when
+ * the edge files are in memory.
+ *
+ * The pages of all disks are laid out back to back (page ids for dense
+ * rounds, positions in the page list for sparse rounds) and split evenly
+ * among workers. A worker takes MEM_PAGES_PER_CHUNK pages at a time from
+ * its own range and steals chunks from the other ranges once it is empty.
+ */
+class MemScheduler {
+ public:
+    MemScheduler(int num_workers)
+        :   _num_workers(num_workers),
+            _cursors(num_workers),
+            _num_steals(0)
+    {}
+
+    template <typename Gr>
+    void setFrontier(Gr& graph, bool dense_all, std::vector<PageList*>& sparse_page_frontier) {
+        int num_disks = graph.NumberOfDisks();
+        bool sparse = !sparse_page_frontier.empty();
+
+        _disks.clear();
+        uint64_t total = 0;
+        for (int i = 0; i < num_disks; i++) {
+            Disk disk;
+            disk.beg = total;
+            disk.pages = sparse ? sparse_page_frontier[i] : nullptr;
+            disk.bitmap = (sparse || dense_all) ? nullptr : graph.GetActivatedPages(i);
+            total += sparse ? disk.pages->size() : graph.GetNumPages(i);
+            _disks.push_back(disk);
+        }
+
+        for (int i = 0; i < _num_workers; i++) {
+            _cursors[i].next = total * i / _num_workers;
+            _cursors[i].end = total * (i + 1) / _num_workers;
+        }
+        _num_steals = 0;
+    }
+
+    // Get the next chunk [*beg, *end) for worker id
+    bool next(int id, uint64_t* beg, uint64_t* end) {
+        for (int i = 0; i < _num_workers; i++) {
+            Cursor& cursor = _cursors[(id + i) % _num_workers];
+            uint64_t pos = cursor.next.fetch_add(MEM_PAGES_PER_CHUNK);
+            if (pos < cursor.end) {
+                *beg = pos;
+                *end = std::min(pos + MEM_PAGES_PER_CHUNK, cursor.end);
+                if (i) _num_steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Call f(disk_id, pid_in_disk) for every activated page in [beg, end)
+    template <typename F>
+    void forEachPage(uint64_t beg, uint64_t end, F&& f) const {
+        int disk_id = findDisk(beg);
+        while (beg < end) {
+            const Disk& disk = _disks[disk_id];
+            uint64_t disk_end = disk_id + 1 < (int)_disks.size() ? _disks[disk_id + 1].beg : end;
+            uint64_t last = std::min(end, disk_end);
+            for (uint64_t pos = beg - disk.beg; pos < last - disk.beg; pos++) {
+                if (disk.pages)
+                    f(disk_id, (*disk.pages)[pos]);
+                else if (!disk.bitmap || disk.bitmap->get_bit(pos))
+                    f(disk_id, (PAGEID)pos);
+            }
+            beg = last;
+            disk_id++;
+        }
+    }
+
+    uint64_t getNumSteals() const {
+        return _num_steals;
+    }
+
+ private:
+    struct Disk {
+        uint64_t    beg;
+        PageList*   pages;      // sparse
+        Bitmap*     bitmap;     // dense
+    };
+
+    struct alignas(CACHE_LINE) Cursor {
+        std::atomic<uint64_t>   next;
+        uint64_t                end;
+    };
+
+    int findDisk(uint64_t pos) const {
+        int disk_id = 0;
+        while (disk_id + 1 < (int)_disks.size() && _disks[disk_id + 1].beg <= pos)
+            disk_id++;
+        return disk_id;
+    }
+
+ private:
+    int                     _num_workers;
+    std::vector<Disk>       _disks;
+    std::vector<Cursor>     _cursors;
+    std::atomic<uint64_t>   _num_steals;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_MEM_SCHEDULER_H
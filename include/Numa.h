@@ -0,0 +1,158 @@
+#ifndef BLAZE_NUMA_H
+#define BLAZE_NUMA_H
+
+#include <sched.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <unistd.h>
+#include "galois/substrate/HWTopo.h"
+#include "Config.h"
+#include "Util.h"
+#include "Param.h"
+
+namespace blaze {
+
+/*
+ * NUMA nodes of the machine as seen by the Galois thread pool, which
+ * binds thread tid to one hardware context. Workers can be re-pinned to
+ * all CPUs of a node; the node of a thread is tracked here so that memory
+ * can follow the thread that uses it.
+ */
+class NumaTopology {
+ public:
+    static NumaTopology& get() {
+        static NumaTopology topology;
+        return topology;
+    }
+
+    int getNumNodes() const {
+        return _node_cpus.size();
+    }
+
+    // Node thread tid (Galois id) runs on
+    int getNodeOfThread(unsigned tid) const {
+        return tid < _thread_node.size() ? _thread_node[tid] : 0;
+    }
+
+    // Pin the calling thread tid to every CPU of node
+    bool pinSelf(unsigned tid, int node) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (unsigned cpu : _node_cpus[node]) {
+            CPU_SET(cpu, &mask);
+        }
+        if (sched_setaffinity(0, sizeof(mask), &mask))
+            return false;
+        if (tid < _thread_node.size())
+            _thread_node[tid] = node;
+        return true;
+    }
+
+    // Node of the PCIe root the device holding fd hangs off, -1 if unknown
+    int getNodeOfFile(int fd) const {
+        struct stat st;
+        if (fstat(fd, &st)) return -1;
+
+        // the file lives on a block device, a partition has its disk as parent
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/dev/block/%u:%u",
+                 major(st.st_dev), minor(st.st_dev));
+        std::string dev(path);
+        const char* candidates[] = { "/device/numa_node", "/device/device/numa_node",
+                                     "/../device/numa_node", "/../device/device/numa_node" };
+        for (const char* candidate : candidates) {
+            int node = readNode(dev + candidate);
+            if (node >= 0 && node < getNumNodes())
+                return node;
+        }
+        return -1;
+    }
+
+ private:
+    NumaTopology() {
+        auto topo = galois::substrate::getHWTopo();
+        int num_nodes = 0;
+        for (auto& thread : topo.second) {
+            num_nodes = std::max(num_nodes, (int)thread.osNumaNode + 1);
+        }
+        _node_cpus.resize(std::max(num_nodes, 1));
+        for (auto& thread : topo.second) {
+            _thread_node.push_back(thread.osNumaNode);
+            _node_cpus[thread.osNumaNode].push_back(thread.osContext);
+        }
+    }
+
+    static int readNode(const std::string& path) {
+        FILE* fp = fopen(path.c_str(), "r");
+        if (!fp) return -1;
+        int node = -1;
+        if (fscanf(fp, "%d", &node) != 1) node = -1;
+        fclose(fp);
+        return node;
+    }
+
+ private:
+    std::vector<int>                    _thread_node;
+    std::vector<std::vector<unsigned>>  _node_cpus;
+};
+
+/*
+ * Memory policies through mbind(2). They apply to pages faulted after
+ * the call, or move resident pages when move is set. Pages pinned by the
+ * kernel (e.g. registered io_uring buffers) may stay where they are.
+ */
+inline bool numaBind(void* addr, size_t len, int mode, const std::vector<int>& nodes, bool move) {
+    const int max_nodes = 1024;
+    unsigned long mask[max_nodes / (8 * sizeof(unsigned long))] = {};
+    for (int node : nodes) {
+        mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    }
+    unsigned flags = move ? MPOL_MF_MOVE : 0;
+    return syscall(SYS_mbind, addr, len, mode, mask, max_nodes, flags) == 0;
+}
+
+inline bool numaBindToNode(void* addr, size_t len, int node, bool move = false) {
+    return numaBind(addr, len, MPOL_PREFERRED, { node }, move);
+}
+
+inline bool numaInterleave(void* addr, size_t len) {
+    int num_nodes = NumaTopology::get().getNumNodes();
+    std::vector<int> nodes;
+    for (int i = 0; i < num_nodes; i++) {
+        nodes.push_back(i);
+    }
+    return numaBind(addr, len, MPOL_INTERLEAVE, nodes, false);
+}
+
+// One contiguous, page-aligned block of the range per node
+inline bool numaPartition(void* addr, size_t len) {
+    int num_nodes = NumaTopology::get().getNumNodes();
+    size_t block = ALIGN_UPTO((len + num_nodes - 1) / num_nodes, PAGE_SIZE);
+    bool ok = true;
+    for (int i = 0; i < num_nodes && (size_t)i * block < len; i++) {
+        size_t beg = (size_t)i * block;
+        ok &= numaBindToNode((char*)addr + beg, std::min(block, len - beg), i);
+    }
+    return ok;
+}
+
+// Placement of Array<T> allocations, set by Runtime from the config
+inline NumaPlacement arrayPlacement = NUMA_LOCAL;
+
+inline bool numaPlace(void* addr, size_t len, NumaPlacement placement) {
+    if (placement == NUMA_INTERLEAVED)
+        return numaInterleave(addr, len);
+    if (placement == NUMA_PARTITIONED)
+        return numaPartition(addr, len);
+    return true;
+}
+
+} // namespace blaze
+
+#endif // BLAZE_NUMA_H
@@ -8,6 +8,8 @@
 #include "GatherWorker.h"
 #include "Synchronization.h"
 #include "Bin.h"
+#include "Numa.h"
+#include "WorkerPool.h"
 
 namespace blaze {
 
@@ -16,20 +18,28 @@ class PBEngine {
     PBEngine(int start_tid,
              int num_scatter_workers,
              int num_gather_workers,
-             std::vector<MPMCQueue<IoItem*>*>& fetch_pages)
+             std::vector<MPMCQueue<IoItem*>*>& fetch_pages,
+             WorkerPool& thread_pool,
+             bool numa = false)
         :   _start_tid(start_tid),
+            _numa(numa),
             _in_frontier(nullptr),
             _out_frontier(nullptr),
-            _thread_pool(galois::substrate::getThreadPool())
+            _thread_pool(thread_pool)
     {
+        NumaTopology& topology = NumaTopology::get();
+
         // binning workers
         for (int i = 0; i < num_scatter_workers; ++i) {
-            _scatter_workers.push_back(new ScatterWorker(i, fetch_pages));
+            _scatter_workers.push_back(new ScatterWorker(i, num_scatter_workers, fetch_pages));
+            _scatter_nodes.push_back(numa ? topology.getNodeOfThread(start_tid + i) : 0);
         }
 
         // accumulate workers
         for (int i = 0; i < num_gather_workers; ++i) {
-            _gather_workers.push_back(new GatherWorker(i));
+            int node = numa ? topology.getNodeOfThread(start_tid + num_scatter_workers + i) : 0;
+            _gather_workers.push_back(new GatherWorker(i, node));
+            _gather_nodes.push_back(node);
         }
     }
 
@@ -61,33 +71,33 @@ class PBEngine {
         }
     }
 
+    // With a MemScheduler scatter workers take pages from memory instead of IO;
+    // with in_graph they take the pages of both graphs of a fused edgeMap
     template <typename Gr, typename Func>
-    void start(Gr& graph, Func& func, Synchronization& sync) {
+    void start(Gr& graph, Func& func, Synchronization& sync, MemScheduler* mem = nullptr,
+               Gr* in_graph = nullptr) {
         _time_start = std::chrono::steady_clock::now();
 
+        if (_numa)
+            func.get_bins()->place(_scatter_nodes, _gather_nodes);
+
         // start binning workers
-        std::vector<std::function<void(void)>> functions;
-        for (auto worker : _scatter_workers) {
-            std::function<void(void)> f = std::bind(&ScatterWorker::run<Gr, Func>,
-                                                    worker,
-                                                    std::ref(graph),
-                                                    std::ref(func), 
-                                                    std::ref(sync));
-            functions.push_back(f);
-        }
-        _thread_pool.fork(_start_tid, _scatter_workers.size(), functions);
+        ScatterWorker** scatter_workers = _scatter_workers.data();
+        if (mem)
+            _thread_pool.fork(_start_tid, _scatter_workers.size(), [scatter_workers, &graph, &func, mem](int i) {
+                scatter_workers[i]->runInMemory(graph, func, *mem);
+            });
+        else
+            _thread_pool.fork(_start_tid, _scatter_workers.size(), [scatter_workers, &graph, &func, &sync, in_graph](int i) {
+                scatter_workers[i]->run(graph, func, sync, in_graph);
+            });
 
         // start accumulate workers
-        functions.clear();
-        for (auto worker : _gather_workers) {
-            std::function<void(void)> f = std::bind(&GatherWorker::run<Gr, Func>,
-                                                    worker,
-                                                    std::ref(graph),
-                                                    std::ref(func), 
-                                                    std::ref(sync));
-            functions.push_back(f);
-        }
-        _thread_pool.fork(_start_tid + _scatter_workers.size(), _gather_workers.size(), functions);
+        GatherWorker** gather_workers = _gather_workers.data();
+        _thread_pool.fork(_start_tid + _scatter_workers.size(), _gather_workers.size(),
+                          [gather_workers, &graph, &func, &sync](int i) {
+                              gather_workers[i]->run(graph, func, sync);
+                          });
     }
 
     template <typename Gr, typename Func>
@@ -98,6 +108,7 @@ class PBEngine {
         func.get_bins()->flush_all();
 
         sync.mark_binning_done();
+        func.get_bins()->notify_gather();
 
         // join accumulate workers
         _thread_pool.join(_start_tid + _scatter_workers.size());
@@ -112,6 +123,14 @@ class PBEngine {
         return _scatter_workers.size();
     }
 
+    uint64_t getNumSteals() const {
+        uint64_t steals = 0;
+        for (auto worker : _scatter_workers) {
+            steals += worker->getNumSteals();
+        }
+        return steals;
+    }
+
     int getNumberOfGatherWorkers() const {
         return _gather_workers.size();
     }
@@ -200,11 +219,14 @@ class PBEngine {
 
  private:
     int                                     _start_tid;
+    bool                                    _numa;
+    std::vector<int>                        _scatter_nodes;
+    std::vector<int>                        _gather_nodes;
     std::vector<ScatterWorker*>             _scatter_workers;
     std::vector<GatherWorker*>              _gather_workers;
     Worklist<VID>*                          _in_frontier;
     Worklist<VID>*                          _out_frontier;
-    galois::substrate::ThreadPool&          _thread_pool;
+    WorkerPool&                             _thread_pool;
     std::chrono::time_point<std::chrono::steady_clock>  _time_start;
     std::chrono::time_point<std::chrono::steady_clock>  _time_end;
 };
@@ -0,0 +1,313 @@
+#ifndef BLAZE_PAGE_CACHE_H
+#define BLAZE_PAGE_CACHE_H
+
+#include <vector>
+#include <unordered_map>
+#include <sys/mman.h>
+#include "galois/Galois.h"
+#include "galois/Bag.h"
+#include "Type.h"
+#include "Bitmap.h"
+#include "Config.h"
+#include "Util.h"
+#include "Param.h"
+
+namespace blaze {
+
+/*
+ * In-memory cache of edge pages owned by a single IO worker, so no
+ * locking is needed. Pages of every edge file the worker has read share
+ * one arena; each file gets a page-to-slot table on first use.
+ *
+ * Slots have the block size of the first file attached; the arena is
+ * allocated then and later files must use the same block size.
+ *
+ * CACHE_CLOCK and CACHE_LRU admit every page read from disk and evict
+ * under pressure. CACHE_PIN only admits pages selected up front (see
+ * selectHubPages) and never evicts.
+ */
+class PageCache {
+ public:
+    PageCache(uint64_t size, CachePolicy policy)
+        :   _policy(policy),
+            _size(size),
+            _base(nullptr),
+            _slot_size(0),
+            _num_slots(0),
+            _num_used(0),
+            _owners(nullptr), _ref(nullptr),
+            _hand(0), _prev(nullptr), _next(nullptr), _lru_head(-1), _lru_tail(-1),
+            _cur(nullptr)
+    {}
+
+    ~PageCache() {
+        for (auto& it : _tables) {
+            delete [] it.second.slots;
+        }
+        if (_base)
+            munmap(_base, _num_slots * _slot_size);
+        delete [] _owners;
+        delete [] _ref;
+        delete [] _prev;
+        delete [] _next;
+    }
+
+    // Select the edge file the following calls refer to.
+    // pinned lists the admissible pages for CACHE_PIN and is kept by the caller.
+    void attach(int fd, uint64_t num_pages, uint32_t block_size, Bitmap* pinned) {
+        if (!_base)
+            allocate(block_size);
+        if (block_size != _slot_size)
+            BLAZE_DIE("Page cache: edge files with different block sizes (",
+                      _slot_size, " and ", block_size, ")");
+
+        auto it = _tables.find(fd);
+        if (it == _tables.end()) {
+            Table table;
+            table.file = _tables.size();
+            table.num_pages = num_pages;
+            table.slots = new int32_t [num_pages];
+            for (uint64_t i = 0; i < num_pages; i++) {
+                table.slots[i] = -1;
+            }
+            it = _tables.emplace(fd, table).first;
+            _files.push_back(&it->second);
+        }
+        _cur = &it->second;
+        _cur->pinned = pinned;
+    }
+
+    bool contains(PAGEID pid) const {
+        return _cur->slots[pid] >= 0;
+    }
+
+    // Copy a cached page into buf and record the access
+    void read(PAGEID pid, char* buf) {
+        int32_t slot = _cur->slots[pid];
+        assert(slot >= 0);
+        memcpy(buf, _base + (uint64_t)slot * _slot_size, _slot_size);
+        touch(slot);
+    }
+
+    // Offer a page that has just been read from disk
+    void insert(PAGEID pid, const char* buf) {
+        if (contains(pid)) return;
+        if (_policy == CACHE_PIN && (!_cur->pinned || !_cur->pinned->get_bit(pid)))
+            return;
+
+        int32_t slot;
+        if (_num_used < _num_slots) {
+            slot = _num_used++;
+        } else {
+            if (_policy == CACHE_PIN) return;
+            slot = evict();
+        }
+
+        memcpy(_base + (uint64_t)slot * _slot_size, buf, _slot_size);
+        _owners[slot].file = _cur->file;
+        _owners[slot].page = pid;
+        _cur->slots[pid] = slot;
+        admit(slot);
+    }
+
+    // Cached page of edge file fd, or nullptr, without attaching the file.
+    // Used from other threads only while the owning IO worker is idle.
+    const char* find(int fd, PAGEID pid) {
+        auto it = _tables.find(fd);
+        if (it == _tables.end())
+            return nullptr;
+        int32_t slot = it->second.slots[pid];
+        if (slot < 0)
+            return nullptr;
+        touch(slot);
+        return _base + (uint64_t)slot * _slot_size;
+    }
+
+    uint64_t getCapacity() const {
+        return _size;
+    }
+
+ private:
+    struct Table {
+        int         file;
+        uint64_t    num_pages;
+        int32_t*    slots;
+        Bitmap*     pinned;
+    };
+
+    struct Owner {
+        int         file;
+        PAGEID      page;
+    };
+
+    void allocate(uint32_t slot_size) {
+        _slot_size = slot_size;
+        _num_slots = _size / _slot_size;
+        BLAZE_ASSERT(_num_slots > 0, "Page cache is smaller than a block");
+        _base = (char*)mmap(nullptr, _num_slots * _slot_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (_base == MAP_FAILED) BLAZE_SYS_DIE("Failed to allocate page cache");
+
+        _owners = new Owner [_num_slots];
+        _ref = new uint8_t [_num_slots];
+        _prev = new int32_t [_num_slots];
+        _next = new int32_t [_num_slots];
+        for (uint64_t i = 0; i < _num_slots; i++) {
+            _ref[i] = 0;
+            _prev[i] = _next[i] = -1;
+        }
+    }
+
+    void touch(int32_t slot) {
+        if (_policy == CACHE_CLOCK) {
+            _ref[slot] = 1;
+        } else if (_policy == CACHE_LRU) {
+            unlink(slot);
+            pushFront(slot);
+        }
+    }
+
+    void admit(int32_t slot) {
+        if (_policy == CACHE_CLOCK) {
+            _ref[slot] = 0;
+        } else if (_policy == CACHE_LRU) {
+            pushFront(slot);
+        }
+    }
+
+    int32_t evict() {
+        int32_t slot;
+        if (_policy == CACHE_CLOCK) {
+            while (_ref[_hand]) {
+                _ref[_hand] = 0;
+                _hand = (_hand + 1) % _num_slots;
+            }
+            slot = _hand;
+            _hand = (_hand + 1) % _num_slots;
+        } else {
+            slot = _lru_tail;
+            unlink(slot);
+        }
+        Owner& owner = _owners[slot];
+        _files[owner.file]->slots[owner.page] = -1;
+        return slot;
+    }
+
+    void pushFront(int32_t slot) {
+        _prev[slot] = -1;
+        _next[slot] = _lru_head;
+        if (_lru_head >= 0) _prev[_lru_head] = slot;
+        _lru_head = slot;
+        if (_lru_tail < 0) _lru_tail = slot;
+    }
+
+    void unlink(int32_t slot) {
+        if (_prev[slot] >= 0) _next[_prev[slot]] = _next[slot];
+        else                  _lru_head = _next[slot];
+        if (_next[slot] >= 0) _prev[_next[slot]] = _prev[slot];
+        else                  _lru_tail = _prev[slot];
+        _prev[slot] = _next[slot] = -1;
+    }
+
+ private:
+    CachePolicy                     _policy;
+    uint64_t                        _size;
+    char*                           _base;
+    uint32_t                        _slot_size;
+    uint64_t                        _num_slots;
+    uint64_t                        _num_used;
+    Owner*                          _owners;
+    // CLOCK
+    uint8_t*                        _ref;
+    uint64_t                        _hand;
+    // LRU
+    int32_t*                        _prev;
+    int32_t*                        _next;
+    int32_t                         _lru_head;
+    int32_t                         _lru_tail;
+    // per edge file
+    std::unordered_map<int, Table>  _tables;
+    std::vector<Table*>             _files;
+    Table*                          _cur;
+};
+
+inline int degreeClass(uint32_t degree) {
+    return 31 - __builtin_clz(degree);
+}
+
+/*
+ * Degree-aware static pinning: mark the pages holding the adjacency of
+ * the highest-degree vertices until every cache holds pages_per_cache
+ * pages. owner(disk_id, pid_in_disk) is the cache, of num_caches, that a
+ * page is read into. Returns a bitmap per disk.
+ */
+template <typename Gr, typename F>
+std::vector<Bitmap*> selectHubPages(Gr& graph, int num_caches, uint64_t pages_per_cache, F&& owner) {
+    int num_disks = graph.NumberOfDisks();
+
+    std::vector<Bitmap*> pinned;
+    for (int i = 0; i < num_disks; i++) {
+        pinned.push_back(new Bitmap(graph.GetNumPages(i)));
+    }
+    std::vector<uint64_t> num_pinned(num_caches, 0);
+
+    // Pages taken by vertices of each degree class (floor of log2).
+    // Only the classes that fill the caches are sorted by degree.
+    const int num_classes = 32;
+    galois::GAccumulator<uint64_t> class_pages[num_classes];
+    galois::do_all(galois::iterate(graph),
+                    [&](const VID& vid) {
+                        uint32_t degree = graph.GetDegree(vid);
+                        if (degree)
+                            class_pages[degreeClass(degree)] += graph.GetEdgeBytes(vid) / graph.GetBlockSize() + 1;
+                    }, galois::no_stats());
+
+    int min_class = num_classes - 1;
+    uint64_t sum_pages = 0;
+    while (min_class > 0) {
+        sum_pages += class_pages[min_class].reduce();
+        if (sum_pages >= pages_per_cache * num_caches)
+            break;
+        min_class--;
+    }
+
+    galois::InsertBag<VID> candidates;
+    galois::do_all(galois::iterate(graph),
+                    [&](const VID& vid) {
+                        uint32_t degree = graph.GetDegree(vid);
+                        if (degree && degreeClass(degree) >= min_class)
+                            candidates.push(vid);
+                    }, galois::no_stats());
+
+    std::vector<VID> hubs(candidates.begin(), candidates.end());
+    std::sort(hubs.begin(), hubs.end(),
+                [&](const VID& a, const VID& b) {
+                    return graph.GetDegree(a) > graph.GetDegree(b);
+                });
+
+    int num_full = 0;
+    for (VID vid : hubs) {
+        if (num_full == num_caches || !graph.GetDegree(vid))
+            break;
+
+        PAGEID pid, pid_end;
+        graph.GetPageRange(vid, &pid, &pid_end);
+        int disk_id;
+        PAGEID pid_in_disk;
+        while (pid <= pid_end) {
+            graph.GetPageLocation(pid++, &disk_id, &pid_in_disk);
+            int cache = owner(disk_id, pid_in_disk);
+            if (num_pinned[cache] == pages_per_cache || pinned[disk_id]->get_bit(pid_in_disk))
+                continue;
+            pinned[disk_id]->set_bit(pid_in_disk);
+            if (++num_pinned[cache] == pages_per_cache)
+                num_full++;
+        }
+    }
+
+    return pinned;
+}
+
+} // namespace blaze
+
+#endif // BLAZE_PAGE_CACHE_H
@@ -4,18 +4,54 @@
 #define CACHE_LINE 64
 
 // IO
-#define PAGE_SIZE               4096
+#define PAGE_SIZE               4096    // memory pages, and edge blocks of older graphs
 #define PAGE_SHIFT              12
-#define IO_QUEUE_DEPTH          64
-#define IO_MAX_PAGES_PER_REQ    4
+#define MAX_BLOCK_SIZE          (1 << 20)   // edge blocks, see graph_header::block_size
+#define IO_QUEUE_DEPTH          64      // default, see -ioQueueDepth
+#define IO_MAX_QUEUE_DEPTH      4096
+#define IO_REQ_SIZE             (16 << 10)  // default, see -ioRequestSize
+#define IO_MAX_REQ_SIZE         (1 << 20)
+#define HUGE_PAGE_SIZE          (2 << 20)
+
+// IO probe (-ioProbe)
+#define IO_PROBE_MIN_DEPTH      4
+#define IO_PROBE_MAX_DEPTH      256
+#define IO_PROBE_DURATION_MS    50
+#define IO_PROBE_BANDWIDTH_SLACK 0.05  // settle for this much less bandwidth
+#define IO_PROBE_MAX_P99_US     10000
+
+// Speculative reads for the next round (-ioSpeculate)
+#define IO_SPECULATE_BUFFER_RATIO 0.5  // share of an IO worker's buffers to read ahead into
+#define IO_SPECULATE_MIN_USE    0.5     // skip a round after a worse guess
+
+// In-memory mode
+#define MEM_PAGES_PER_CHUNK     64      // pages a compute worker takes at once
 
 // IO page queue
 #define IO_PAGE_QUEUE_INIT_SIZE 16384
 #define IO_PAGE_QUEUE_BULK_DEQ  2048
+#define IO_PAGE_QUEUE_STEAL_DEQ 8
+
+// Waiting (see Wait.h)
+#define WAIT_SPIN_ROUNDS        64
+#define WAIT_PAUSE_ROUNDS       256
+#define WAIT_PAUSES_PER_ROUND   16
+#define WAIT_PARK_TIMEOUT_US    1000
+
+// Resident workers (see WorkerPool.h)
+#define WORKER_TASK_SIZE        64      // bytes of a round's closure
+
+// IO statistics (-ioStats)
+#define LATENCY_SUB_BITS        4
+#define IO_TIMELINE_INTERVAL_US 100
+#define IO_TIMELINE_MAX_SAMPLES 1024
 
 // Sparse dense
 #define DENSE_THRESHOLD         0.005
 
+// Tiny sparse frontiers run on the calling thread (-inlinePages)
+#define INLINE_MAX_PAGES        64      // default, 0 disables
+
 // Binning
 #define BINNING_WORKER_RATIO    0.67
 #define BIN_COUNT               4096
@@ -1,6 +1,8 @@
 #ifndef BLAZE_QUEUE_H
 #define BLAZE_QUEUE_H
 
+#include <vector>
+#include <algorithm>
 #include "concurrentqueue/concurrentqueue.h"
 #include "concurrentqueue/blockingconcurrentqueue.h"
 
@@ -12,4 +14,50 @@ using MPMCQueue = moodycamel::ConcurrentQueue<T>;
 template <typename T>
 using SPSCQueue = blaze::RingBuffer<T>;
 
+namespace blaze {
+
+// Queues read by consumer id when num_consumers consumers share them:
+// every queue has a consumer and every consumer has a queue.
+template <typename T>
+std::vector<MPMCQueue<T>*> assignQueues(int id, int num_consumers,
+                                        const std::vector<MPMCQueue<T>*>& queues) {
+    std::vector<MPMCQueue<T>*> assigned;
+    int num_queues = queues.size();
+    if (num_consumers >= num_queues) {
+        assigned.push_back(queues[id % num_queues]);
+    } else {
+        for (int i = id; i < num_queues; i += num_consumers) {
+            assigned.push_back(queues[i]);
+        }
+    }
+    return assigned;
+}
+
+/*
+ * Take up to max items from one of the queues a consumer does not own,
+ * starting from a random queue. seed is the caller's xorshift state.
+ */
+template <typename T>
+size_t stealQueues(const std::vector<MPMCQueue<T>*>& queues,
+                   const std::vector<MPMCQueue<T>*>& own,
+                   T* items, size_t max, uint32_t& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    size_t num_queues = queues.size();
+    size_t start = seed % num_queues;
+    for (size_t i = 0; i < num_queues; i++) {
+        MPMCQueue<T>* queue = queues[(start + i) % num_queues];
+        if (std::find(own.begin(), own.end(), queue) != own.end())
+            continue;
+        size_t count = queue->try_dequeue_bulk(items, max);
+        if (count)
+            return count;
+    }
+    return 0;
+}
+
+} // namespace blaze
+
 #endif  // BLAZE_QUEUE_H
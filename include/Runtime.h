@@ -5,23 +5,39 @@
 #include "IoEngine.h"
 #include "ComputeEngine.h"
 #include "PBEngine.h"
+#include "InlineReader.h"
+#include "WorkerPool.h"
+#include "Synchronization.h"
+#include "IoSync.h"
 #include "Util.h"
 #include "Bitmap.h"
 #include "atomics.h"
 #include "Param.h"
 #include "Type.h"
 #include "Queue.h"
+#include "Config.h"
+#include "Wait.h"
+#include "Numa.h"
 
 namespace blaze {
 
 class Runtime {
  public:
-    Runtime(int num_compute_threads, int num_io_threads, uint64_t io_buffer_size)
+    Runtime(int num_compute_threads, int num_io_threads, uint64_t io_buffer_size,
+            const Config& config = Config())
         :   _num_compute_threads(num_compute_threads),
             _num_io_threads(num_io_threads),
+            _config(config),
+            _worker_pool(nullptr),
+            _io_engine(nullptr),
             _pb_engine(nullptr),
+            _inline_reader(nullptr),
             _round(0),
             _total_accessed_io_bytes(0),
+            _total_wasted_io_bytes(0),
+            _total_cached_bytes(0),
+            _total_speculated_bytes(0),
+            _total_speculated_used_bytes(0),
             _total_accessed_edges(0),
             _total_io_time(0.0)
     {
@@ -30,31 +46,84 @@ class Runtime {
         num_threads = galois::setActiveThreads(num_threads);
         printf("Number of threads: %d (Compute %d, IO %d)\n",
             num_threads, num_compute_threads, num_io_threads);
+        _worker_pool = new WorkerPool(num_compute_threads + num_io_threads);
+        if (config.numa)
+            pinComputeWorkers();
+        arrayPlacement = config.array_placement;
+        fullOffsetIndex = config.full_offsets;
+        if (config.in_memory) {
+            printf("IO backend: none (edges in memory)\n");
+        } else {
+            printf("IO backend: %s%s%s\n",
+                config.io_backend == IO_BACKEND_URING ? "io_uring" : "aio",
+                config.io_backend == IO_BACKEND_URING && config.io_sqpoll ? " +sqpoll" : "",
+                config.io_backend == IO_BACKEND_URING && config.io_iopoll ? " +iopoll" : "");
+            printf("IO request size: %u kB\n", config.io_request_size / kB);
+            printf("IO queue depth: %u\n", config.io_queue_depth);
+            if (config.cache_size)
+                printf("Page cache: %lu MB (%s)\n", config.cache_size / MB,
+                    config.cache_policy == CACHE_PIN ? "pin" : config.cache_policy == CACHE_LRU ? "lru" : "clock");
+        }
 
 
-        // Initialize ring buffers
-        for (int i = 0; i < num_io_threads; i++) {
+        // Initialize local page queues, one per compute worker
+        for (int i = 0; i < num_compute_threads; i++) {
             _fetched_tasks.push_back(new MPMCQueue<IoItem*>(IO_PAGE_QUEUE_INIT_SIZE));
         }
     
 
-        // Initialize IO engine
-        _io_engine = new IoEngine(num_io_threads,
-                                  num_compute_threads,
-                                  io_buffer_size / num_io_threads,
-                                  _fetched_tasks);
+        // Initialize IO engine, not needed when edges are in memory
+        if (!config.in_memory)
+            _io_engine = new IoEngine(num_io_threads,
+                                      num_compute_threads,
+                                      io_buffer_size,
+                                      _fetched_tasks,
+                                      *_worker_pool,
+                                      config);
+
+        // Tiny frontiers are read on the calling thread
+        if (config.inline_max_pages)
+            _inline_reader = new InlineReader(config.io_backend, config.inline_max_pages);
 
         _compute_engine = new ComputeEngine(1,
                                             num_compute_threads,
-                                            _fetched_tasks);
+                                            _fetched_tasks,
+                                            *_worker_pool);
 
         setRuntimeInstance(this);
     }
 
     ~Runtime() {
+        // what was read ahead after the last round is never used
+        if (_io_engine) {
+            _io_engine->finishSpeculation();
+            addSpeculatedBytes(_io_engine->getTotalBytesSpeculated(), 0);
+        }
+
         double io_bw_in_gbps = _total_io_time > 0 ? (double)_total_accessed_io_bytes / _total_io_time / GB : 0.0;
         printf("# IO SUMMARY    : %'lu bytes, %8.5f sec, %4.2f GB/s\n", _total_accessed_io_bytes, _total_io_time, io_bw_in_gbps);
+        if (_total_speculated_bytes)
+            printf("# IO SPECULATE : %'lu bytes read ahead, %'lu bytes used (%.2f%%)\n",
+                _total_speculated_bytes, _total_speculated_used_bytes,
+                (double)_total_speculated_used_bytes * 100.0 / _total_speculated_bytes);
+        if (_total_cached_bytes) {
+            uint64_t total_bytes = _total_cached_bytes + _total_accessed_io_bytes;
+            printf("# PAGE CACHE  : Benefit %'lu bytes (%.2f%%) hit ratio, %'lu total bytes\n",
+                _total_cached_bytes, (double)_total_cached_bytes * 100.0 / total_bytes, total_bytes);
+        }
+        for (size_t i = 0; _device_io_bytes.size() > 1 && i < _device_io_bytes.size(); i++) {
+            double share = _total_accessed_io_bytes ? (double)_device_io_bytes[i] * 100.0 / _total_accessed_io_bytes : 0.0;
+            printf("# IO DEVICE %3lu : %'lu bytes (%.2f%%)\n", i, _device_io_bytes[i], share);
+        }
+        if (_total_wasted_io_bytes)
+            printf("# IO GAP        : %'lu bytes read to fill gaps\n", _total_wasted_io_bytes);
         printf("# SUMMARY       : %'lu edges accessed.\n", _total_accessed_edges);
+        for (int i = 0; i < NUM_WAIT_SITES; i++) {
+            uint64_t stalls = waitStats[i].stalls;
+            if (stalls)
+                printf("# WAIT %-13s: %'lu stalls, %8.5f sec, %'lu parks\n", waitSiteName(i), stalls,
+                    (double)waitStats[i].nsec / 1e9, (uint64_t)waitStats[i].parks);
+        }
 
         if (_io_engine)
             delete _io_engine;
@@ -65,9 +134,14 @@ class Runtime {
         if (_pb_engine)
             delete _pb_engine;
 
+        if (_inline_reader)
+            delete _inline_reader;
+
         for (auto queue : _fetched_tasks) {
             delete queue;
         }
+
+        delete _worker_pool;
     }
 
     int getNumberOfComputeWorkers() const {
@@ -78,6 +152,10 @@ class Runtime {
         return _num_io_threads;
     }
 
+    const Config& getConfig() const {
+        return _config;
+    }
+
     IoEngine* getIoEngine() {
         return _io_engine;
     }
@@ -86,6 +164,21 @@ class Runtime {
         return _compute_engine;
     }
 
+    InlineReader* getInlineReader() {
+        return _inline_reader;
+    }
+
+    // Kept across rounds, reset for the next one
+    Synchronization& resetSynchronization() {
+        _sync.reset();
+        return _sync;
+    }
+
+    IoSync& resetIoSync(int num_disks) {
+        _io_sync.reset(num_disks);
+        return _io_sync;
+    }
+
     int getRound(void) const {
         return _round;
     }
@@ -98,6 +191,26 @@ class Runtime {
         _total_accessed_io_bytes += bytes;
     }
 
+    void addDeviceIoBytes(int idx, uint64_t bytes) {
+        if (idx >= (int)_device_io_bytes.size())
+            _device_io_bytes.resize(idx + 1, 0);
+        _device_io_bytes[idx] += bytes;
+    }
+
+    void addWastedIoBytes(uint64_t bytes) {
+        _total_wasted_io_bytes += bytes;
+    }
+
+    void addCachedBytes(uint64_t bytes) {
+        _total_cached_bytes += bytes;
+    }
+
+    // Read between rounds, not counted in the IO bytes of a round
+    void addSpeculatedBytes(uint64_t bytes, uint64_t used_bytes) {
+        _total_speculated_bytes += bytes;
+        _total_speculated_used_bytes += used_bytes;
+    }
+
     void addAccessedEdges(uint64_t edges) {
         _total_accessed_edges += edges;
     }
@@ -117,13 +230,36 @@ class Runtime {
         _pb_engine = new PBEngine(1,
                                   num_bin_workers,
                                   num_acc_workers,
-                                  _fetched_tasks);
+                                  _fetched_tasks,
+                                  *_worker_pool,
+                                  _config.numa);
     }
 
     PBEngine* getPBEngine() {
         return _pb_engine;
     }
 
+ private:
+    // Compute worker i (thread 1 + i) goes to node i % N, so that scatter
+    // and gather workers are spread over all nodes. IO workers follow
+    // their device once it is known.
+    void pinComputeWorkers() {
+        NumaTopology& topology = NumaTopology::get();
+        int num_nodes = topology.getNumNodes();
+        int num_compute_threads = _num_compute_threads;
+        galois::on_each([&](unsigned tid, unsigned) {
+            if (tid >= 1 && tid <= (unsigned)num_compute_threads)
+                topology.pinSelf(tid, (tid - 1) % num_nodes);
+        });
+        // and the resident workers that take over these thread ids
+        NumaTopology* topo = &topology;
+        _worker_pool->fork(1, num_compute_threads, [topo, num_nodes](int i) {
+            topo->pinSelf(1 + i, i % num_nodes);
+        });
+        _worker_pool->join(1);
+        printf("NUMA nodes: %d\n", num_nodes);
+    }
+
  public:
     static Runtime* runtimeInstance;
 
@@ -142,6 +278,12 @@ class Runtime {
     galois::SharedMemSys    _galoisRuntime;
     int                     _num_compute_threads;
     int                     _num_io_threads;
+    Config                  _config;
+
+    // IO and compute workers, parked between rounds
+    WorkerPool*             _worker_pool;
+    Synchronization         _sync;
+    IoSync                  _io_sync;
 
     // io execution
     IoEngine*               _io_engine;
@@ -152,12 +294,20 @@ class Runtime {
     // bin-based execution
     PBEngine*               _pb_engine;
 
+    // edgeMap on tiny frontiers
+    InlineReader*           _inline_reader;
+
     // ring buffers
     std::vector<MPMCQueue<IoItem*>*>    _fetched_tasks;
 
     // stat
     int                     _round;
     uint64_t                _total_accessed_io_bytes;
+    uint64_t                _total_wasted_io_bytes;
+    std::vector<uint64_t>   _device_io_bytes;
+    uint64_t                _total_cached_bytes;
+    uint64_t                _total_speculated_bytes;
+    uint64_t                _total_speculated_used_bytes;
     uint64_t                _total_accessed_edges;
     double                  _total_io_time;
     MemoryCounter           _mem_counter;
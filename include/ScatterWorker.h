@@ -5,7 +5,10 @@
 #include "Type.h"
 #include "galois/Bag.h"
 #include "Synchronization.h"
+#include "IoBufferPool.h"
+#include "MemScheduler.h"
 #include "Queue.h"
+#include "Wait.h"
 #include "Param.h"
 #include "Bin.h"
 
@@ -14,14 +17,17 @@ namespace blaze {
 class ScatterWorker {
  public:
     ScatterWorker(int id,
+                  int num_workers,
                   std::vector<MPMCQueue<IoItem*>*>& fetched_pages)
         :   _id(id),
-            _num_disks(0),
+            _num_workers(num_workers),
             _fetched_pages(fetched_pages),
             _in_frontier(nullptr),
             _bins(nullptr),
             _time(0.0),
-            _num_processed_pages(0)
+            _num_processed_pages(0),
+            _num_steals(0),
+            _seed(id * 2654435761u + 1)
     {}
 
     ~ScatterWorker() {}
@@ -30,34 +36,55 @@ class ScatterWorker {
         _in_frontier = in;
     }
 
+    // Pages tagged 1 belong to in_graph (fused edgeMap)
     template <typename Gr, typename Func>
-    void run(Gr& graph, Func& func, Synchronization& sync) {
+    void run(Gr& graph, Func& func, Synchronization& sync, Gr* in_graph = nullptr) {
         auto time_start = std::chrono::steady_clock::now();
 
-        _num_disks = graph.NumberOfDisks();
-        _p2v_map = &graph.GetP2VMap();
         _bins = func.get_bins();
 
         sync.wait_io_start();
 
+        auto queues = assignQueues(_id, _num_workers, _fetched_pages);
+        _num_steals = 0;
+
         IoItem *items[IO_PAGE_QUEUE_BULK_DEQ];
-        size_t count;
+        size_t count, total;
         bool io_done = false;
 
+        Waiter waiter(WAIT_FETCHED_PAGES, &sync.fetched_pages());
+
         while (1) {
             do {
-                count = _fetched_pages[_id % _num_disks]->try_dequeue_bulk(items, IO_PAGE_QUEUE_BULK_DEQ);
-                for (size_t i = 0; i < count; i++) {
-                    processFetchedPages(graph, func, *items[i], sync);
-                    delete items[i];
+                total = 0;
+                for (auto queue : queues) {
+                    count = queue->try_dequeue_bulk(items, IO_PAGE_QUEUE_BULK_DEQ);
+                    for (size_t i = 0; i < count; i++) {
+                        processFetchedPages(items[i]->graph ? *in_graph : graph, func, *items[i], sync);
+                    }
+                    total += count;
+                }
+
+                // own queues are empty: steal from other workers
+                if (!total) {
+                    count = stealQueues(_fetched_pages, queues, items, IO_PAGE_QUEUE_STEAL_DEQ, _seed);
+                    for (size_t i = 0; i < count; i++) {
+                        processFetchedPages(items[i]->graph ? *in_graph : graph, func, *items[i], sync);
+                    }
+                    _num_steals += count;
+                    total += count;
                 }
-            } while (count > 0);
+
+                if (total) waiter.done();
+            } while (total > 0);
 
             if (sync.check_io_done()) {
                 // All completed IOs are sent and placed in the ring buffer.
                 // One more loop is required to process them.
                 if (!io_done) io_done = true;
                 else                    break;
+            } else {
+                waiter.wait();
             }
         }
 
@@ -71,10 +98,42 @@ class ScatterWorker {
         _time = elapsed.count();
     }
 
+    // In-memory mode: take pages straight from the graph
+    template <typename Gr, typename Func>
+    void runInMemory(Gr& graph, Func& func, MemScheduler& scheduler) {
+        auto time_start = std::chrono::steady_clock::now();
+
+        const int num_disks = graph.NumberOfDisks();
+        _bins = func.get_bins();
+
+        uint64_t beg, end;
+        while (scheduler.next(_id, &beg, &end)) {
+            scheduler.forEachPage(beg, end,
+                [&](int disk_id, PAGEID ppid) {
+                    processFetchedPage(graph, func, ppid * num_disks + disk_id,
+                                       graph.GetEdgePage(disk_id, ppid));
+                    _num_processed_pages++;
+                });
+        }
+
+        _bins->flush(_id);
+
+        _in_frontier = nullptr;
+
+        auto time_end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = time_end - time_start;
+        _time = elapsed.count();
+    }
+
     uint64_t getNumProcessedPages() const {
         return _num_processed_pages;
     }
 
+    // IO items taken from other workers' queues in the last run
+    uint64_t getNumSteals() const {
+        return _num_steals;
+    }
+
     double getTime() const {
         return _time;
     }
@@ -85,34 +144,16 @@ class ScatterWorker {
 
  private:
     template <typename Gr, typename Func>
-    bool applyFunction(Gr& graph, Func& func, const VID& vid, const uint64_t page_start, const uint64_t page_end, char *buffer) {
-        uint32_t degree = graph.GetDegree(vid);
+    bool applyFunction(Gr& graph, Func& func, const VID& vid, uint32_t degree, uint64_t offset,
+                       uint64_t offset_end, const uint64_t page_start, char *buffer) {
         if (!degree || (_in_frontier && !_in_frontier->activated(vid)))
             return false;
 
-        uint64_t offset = graph.GetOffset(vid) * sizeof(VID);
-        uint64_t offset_end = offset + (degree << EDGE_WIDTH_BITS);
-        uint32_t offset_in_buf;
-
-        if (offset < page_start) {
-            degree -= (page_start - offset) >> EDGE_WIDTH_BITS;
-            offset_in_buf = 0;
-
-        } else {
-            offset_in_buf = offset - page_start;
-        }
-
-        if (offset_end > page_end) {
-            degree -= (offset_end - page_end) >> EDGE_WIDTH_BITS;
-        }
-
-        VID* edges = (VID*)(buffer + offset_in_buf);
-
-        for (uint32_t i = 0; i < degree; i++) {
-            VID dst = edges[i];
-            if (func.cond(dst))
-                _bins->append(_id, dst, func.scatter(vid, dst));
-        }
+        graph.ForEachEdgeInBlock(degree, offset, offset_end, page_start, buffer,
+            [&](VID dst, EDGEDATA data) {
+                if (func.cond(dst))
+                    _bins->append(_id, dst, applyScatter(func, vid, dst, data));
+            });
 
         return true;
     }
@@ -122,41 +163,51 @@ class ScatterWorker {
         PAGEID ppid_start = item.page;
         const PAGEID ppid_end       = item.page + item.num;
         char* buffer = item.buf;
+        const int num_disks = graph.NumberOfDisks();
+        const uint32_t block_size = graph.GetBlockSize();
+        // pages read only to fill a gap are not in the page bitmap
+        Bitmap* page_bitmap = item.num_fillers ? graph.GetActivatedPages(item.disk_id) : nullptr;
         while (ppid_start < ppid_end) {
-            const PAGEID pid = ppid_start * _num_disks + item.disk_id;
-            processFetchedPage(graph, func, pid, buffer);
+            const PAGEID pid = ppid_start * num_disks + item.disk_id;
+            if (!page_bitmap || page_bitmap->get_bit(ppid_start))
+                processFetchedPage(graph, func, pid, buffer);
             ppid_start++;
-            buffer += PAGE_SIZE;
+            buffer += block_size;
         }
         _num_processed_pages += item.num;
-        free(item.buf);
-        sync.add_num_free_pages(item.disk_id, item.num);
+        item.pool->release(&item);
     }
 
     template <typename Gr, typename Func>
     void processFetchedPage(Gr& graph, Func& func, PAGEID pid, char* buffer) {
-        const VID vid_start = _p2v_map[pid].first;
-        const VID vid_end       = _p2v_map[pid].second;
+        VidRange* p2v_map = &graph.GetP2VMap();
+        const uint32_t block_size = graph.GetBlockSize();
+        const VID vid_start = p2v_map[pid].first;
+        const VID vid_end       = p2v_map[pid].second;
 
-        const uint64_t page_start = (uint64_t)pid * PAGE_SIZE;
-        const uint64_t page_end = page_start + PAGE_SIZE;
+        const uint64_t page_start = (uint64_t)pid * block_size;
 
+        // the edges of consecutive vertices follow each other
         VID vid = vid_start;
+        uint64_t offset = graph.GetByteOffset(vid);
         while (vid <= vid_end) {
-            applyFunction(graph, func, vid, page_start, page_end, buffer);
+            uint64_t offset_end = offset + graph.GetEdgeBytes(vid);
+            applyFunction(graph, func, vid, graph.GetDegree(vid), offset, offset_end, page_start, buffer);
+            offset = offset_end;
             vid++;
         }
     }
 
  private:
     int                     _id;
-    int                     _num_disks;
-    VidRange*               _p2v_map;
+    int                     _num_workers;
     std::vector<MPMCQueue<IoItem*>*>&     _fetched_pages;
     Worklist<VID>*          _in_frontier;
     Bins*                   _bins;
     double                  _time;
     uint64_t                _num_processed_pages;
+    uint64_t                _num_steals;
+    uint32_t                _seed;
 };
 
 } // namespace blaze
@@ -2,20 +2,19 @@
 #define BLAZE_SYNCHRONIZATION_H
 
 #include "Barrier.h"
+#include "Wait.h"
 
 class Synchronization {
  public:
-    Synchronization(int num_disks)
+    Synchronization()
     : _io_done(false), _binning_done(false)
-    {
-        _num_free_pages = new std::atomic<int64_t> [num_disks];
-        for (int i = 0; i < num_disks; ++i) {
-            _num_free_pages[i] = 0;
-        }
-    }
+    {}
 
-    ~Synchronization() {
-        delete [] _num_free_pages;
+    // Reused across rounds, reset before the workers are started
+    void reset() {
+        _io_ready.reset();
+        atomic_store(&_io_done, false);
+        atomic_store(&_binning_done, false);
     }
 
     void wait_io_start() {
@@ -28,6 +27,7 @@ class Synchronization {
 
     void mark_io_done() {
         atomic_store(&_io_done, true);
+        _fetched_pages.notify_all();
     }
 
     bool check_io_done() {
@@ -42,23 +42,16 @@ class Synchronization {
         return atomic_load(&_binning_done);
     }
 
-    void set_num_free_pages(int disk_id, int64_t num) {
-        atomic_store(&_num_free_pages[disk_id], num);
-    }
- 
-    int64_t get_num_free_pages(int disk_id) {
-        return atomic_load(&_num_free_pages[disk_id]);
+    // Compute workers park here while IO workers have nothing for them
+    blaze::Parking& fetched_pages() {
+        return _fetched_pages;
     }
 
-    void add_num_free_pages(int disk_id, int64_t num) {
-        _num_free_pages[disk_id].fetch_add(num);
-    }
- 
  private:
     Barrier                 _io_ready;
     std::atomic<bool>       _io_done;
     std::atomic<bool>       _binning_done;
-    std::atomic<int64_t>*   _num_free_pages;
+    blaze::Parking          _fetched_pages;
 };
 
 #endif // BLAZE_SYNCHRONIZATION_H
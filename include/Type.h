@@ -3,41 +3,86 @@
 
 #include <vector>
 #include <map>
+#include <type_traits>
 #include "galois/Bag.h"
 #include "Worklist.h"
 #include "galois/substrate/SimpleLock.h"
 
+// Vertex ids, 64 bits with -DBLAZE_VID64=ON for graphs beyond 4G vertices
+#ifdef BLAZE_VID64
+typedef uint64_t VID;
+#define VID_BITS 3
+#define EDGE_WIDTH_BITS 3
+#else
 typedef uint32_t VID;
 #define VID_BITS 2
 #define EDGE_WIDTH_BITS 2
+#endif
+
+const VID VID_NONE = (VID)-1;     // no vertex, e.g. no parent yet
 
 typedef int EDGEDATA;
 //typedef float EDGEDATA;
+
+// Edge tuple of weighted edge files
 struct EdgePair {
     VID dst;
     EDGEDATA data;
 };
+// whole tuples fit in a block
+static_assert((sizeof(EdgePair) & (sizeof(EdgePair) - 1)) == 0, "EdgePair size is not a power of 2");
+
+const EDGEDATA EDGEDATA_UNIT = 1;   // data of the edges of unweighted graphs
 
 struct graph_header {
-    uint64_t unused;
-    uint64_t size_of_edge;
+    uint64_t block_size;        // of edge files in bytes, 0 for PAGE_SIZE (.gr input: version)
+    uint64_t flags;             // GRAPH_* (.gr input: size of edge)
     uint64_t num_nodes;
     uint64_t num_edges;
 };
 
+// graph_header::flags of an index file
+const uint64_t GRAPH_COMPRESSED = 0x1;    // edge blocks of Compression.h
+const uint64_t GRAPH_BYTE_INDEX = 0x2;    // byte offsets and sizes: padded or compressed edges
+const uint64_t GRAPH_VID64 = 0x4;         // 8-byte vertex ids in the edge files
+const uint64_t GRAPH_WEIGHTED = 0x8;      // EdgePair tuples in the edge files
+
+// Edge block ids, 64 bits with -DBLAZE_PAGEID64=ON for edge files beyond
+// 4G blocks (16 TB of 4 kB blocks)
+#ifdef BLAZE_PAGEID64
+typedef uint64_t PAGEID;
+#else
 typedef uint32_t PAGEID;
+#endif
 using VidRange = std::pair<VID, VID>;
 
+namespace blaze {
+class IoBufferPool;
+}
+
 struct IoItem {
     int     disk_id;
+    // graph the pages belong to in a fused edgeMap: 0 out-graph, 1 in-graph
+    int     graph;
     PAGEID  page;
     int     num;
+    // pages read only to bridge holes between activated pages
+    int     num_fillers;
     char*   buf;
-    IoItem(int d, PAGEID p, int n, char* b): disk_id(d), page(p), num(n), buf(b) {}
+    // owner of buf; the item goes back there once processed
+    blaze::IoBufferPool*    pool;
+    // registered buffer index for io_uring fixed reads
+    int     buf_index;
+    // when the read was queued, for latency statistics
+    uint64_t    submit_ns;
+    IoItem(int d, PAGEID p, int n, char* b): disk_id(d), graph(0), page(p), num(n), num_fillers(0), buf(b), pool(nullptr), buf_index(-1), submit_ns(0) {}
 };
 
 using PageReadList = std::vector<std::pair<PAGEID, char *>>;
 
+// sorted, duplicate-free page ids of one disk
+using PageList = std::vector<PAGEID>;
+
 using Mutex = galois::substrate::SimpleLock;
 
 typedef uint32_t FLAGS;
@@ -54,4 +99,48 @@ inline bool use_prop_blocking(const FLAGS& flags) {
 
 enum ComputeWorkerRole { NORMAL, BIN, ACCUMULATE };
 
+namespace blaze {
+
+// Edge functions get the data of an edge if they take it as a third
+// argument: updateAtomic(src, dst, data), scatter(src, dst, data)
+template <typename F, typename = void>
+struct takes_edge_data_update : std::false_type {};
+
+template <typename F>
+struct takes_edge_data_update<F, std::void_t<decltype(
+    std::declval<F&>().updateAtomic(VID(), VID(), EDGEDATA()))>> : std::true_type {};
+
+template <typename F, typename = void>
+struct takes_edge_data_scatter : std::false_type {};
+
+template <typename F>
+struct takes_edge_data_scatter<F, std::void_t<decltype(
+    std::declval<F&>().scatter(VID(), VID(), EDGEDATA()))>> : std::true_type {};
+
+// Only functions with get_bins() are run by the prop-blocking engine
+template <typename F, typename = void>
+struct has_bins : std::false_type {};
+
+template <typename F>
+struct has_bins<F, std::void_t<decltype(
+    std::declval<F&>().get_bins())>> : std::true_type {};
+
+template <typename F>
+inline bool applyUpdateAtomic(F& f, VID src, VID dst, EDGEDATA data) {
+    if constexpr (takes_edge_data_update<F>::value)
+        return f.updateAtomic(src, dst, data);
+    else
+        return f.updateAtomic(src, dst);
+}
+
+template <typename F>
+inline auto applyScatter(F& f, VID src, VID dst, EDGEDATA data) {
+    if constexpr (takes_edge_data_scatter<F>::value)
+        return f.scatter(src, dst, data);
+    else
+        return f.scatter(src, dst);
+}
+
+} // namespace blaze
+
 #endif // BLAZE_TYPES_H
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <cerrno>
 #include <cstdlib>
+#include <cassert>
+#include <cstdint>
 #include <string.h>
 #include <sys/resource.h>
 #include <immintrin.h>
@@ -74,6 +76,56 @@ class Range{
     RangeIter<T_> end() const { return RangeIter<T_>(to_); }
 };
 
+/*
+ * Division of 32-bit values by a divisor fixed at runtime, by one
+ * 64x64 multiply-high (Lemire et al., "Faster Remainder by Direct
+ * Computation"). Powers of two use a shift. 64-bit values above 2^32
+ * take a plain division.
+ */
+class FastDivisor {
+ public:
+    FastDivisor(): _divisor(1), _magic(0), _shift(0) {}
+
+    explicit FastDivisor(uint32_t divisor)
+        :   _divisor(divisor), _magic(0), _shift(0)
+    {
+        assert(divisor > 0);
+        if (divisor & (divisor - 1)) {
+            _magic = UINT64_MAX / divisor + 1;
+        } else {
+            while ((1u << _shift) < divisor) _shift++;
+        }
+    }
+
+    uint32_t divide(uint32_t n) const {
+        if (!_magic) return n >> _shift;
+        return (uint32_t)(((__uint128_t)_magic * n) >> 64);
+    }
+
+    uint32_t modulo(uint32_t n) const {
+        return n - divide(n) * _divisor;
+    }
+
+    uint64_t divide(uint64_t n) const {
+        if (!_magic) return n >> _shift;
+        if (n <= UINT32_MAX) return divide((uint32_t)n);
+        return n / _divisor;
+    }
+
+    uint64_t modulo(uint64_t n) const {
+        return n - divide(n) * _divisor;
+    }
+
+    uint32_t divisor() const {
+        return _divisor;
+    }
+
+ private:
+    uint32_t    _divisor;
+    uint64_t    _magic;
+    int         _shift;
+};
+
 #define NOP10() asm("nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;nop;")
 
 class comma_numpunct : public std::numpunct<char>
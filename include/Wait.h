@@ -0,0 +1,167 @@
+#ifndef BLAZE_WAIT_H
+#define BLAZE_WAIT_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "Param.h"
+
+namespace blaze {
+
+// Places where a worker waits for another one
+enum WaitSite {
+    WAIT_IO_BUFFER,         // IO worker: no free buffer and nothing in flight
+    WAIT_IO_COMPLETION,     // IO worker: blocked in the kernel for a completion
+    WAIT_IO_FRONTIER,       // IO worker: pages above the dense frontier watermark not built yet
+    WAIT_FETCHED_PAGES,     // compute/scatter worker: no page to process
+    WAIT_FULL_BINS,         // gather worker: no full bin
+    WAIT_BIN_SWITCH,        // scatter worker: the other bin of a pair is still gathered
+    NUM_WAIT_SITES
+};
+
+inline const char* waitSiteName(int site) {
+    static const char* names[NUM_WAIT_SITES] = {
+        "io_buffer", "io_completion", "io_frontier", "fetched_pages", "full_bins", "bin_switch"
+    };
+    return names[site];
+}
+
+struct WaitStat {
+    std::atomic<uint64_t>   stalls;
+    std::atomic<uint64_t>   nsec;
+    std::atomic<uint64_t>   parks;
+};
+
+// Process-wide stall counters, one per site
+inline WaitStat waitStats[NUM_WAIT_SITES];
+
+inline void addStall(WaitSite site, uint64_t nsec, uint64_t parks) {
+    waitStats[site].stalls.fetch_add(1, std::memory_order_relaxed);
+    waitStats[site].nsec.fetch_add(nsec, std::memory_order_relaxed);
+    waitStats[site].parks.fetch_add(parks, std::memory_order_relaxed);
+}
+
+// Accounts a blocking call as one stall at site
+class ScopedStall {
+ public:
+    ScopedStall(WaitSite site)
+        :   _site(site), _start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedStall() {
+        auto elapsed = std::chrono::steady_clock::now() - _start;
+        addStall(_site, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), 0);
+    }
+
+ private:
+    WaitSite                _site;
+    std::chrono::time_point<std::chrono::steady_clock>  _start;
+};
+
+/*
+ * Futex word that waiters park on. Every notify_all() bumps the
+ * sequence, so a waiter that took its snapshot before checking its
+ * condition cannot miss a wakeup; the syscall is only made when someone
+ * is parked.
+ */
+class Parking {
+ public:
+    Parking(): _seq(0), _waiters(0) {}
+
+    uint32_t sequence() const {
+        return _seq.load();
+    }
+
+    // Sleep until notified after seq was read, or until timeout_us passes
+    void park(uint32_t seq, long timeout_us) {
+        struct timespec ts = { timeout_us / 1000000, (timeout_us % 1000000) * 1000 };
+        _waiters.fetch_add(1);
+        syscall(SYS_futex, &_seq, FUTEX_WAIT_PRIVATE, seq, &ts, nullptr, 0);
+        _waiters.fetch_sub(1);
+    }
+
+    void notify_all() {
+        _seq.fetch_add(1);
+        if (_waiters.load())
+            syscall(SYS_futex, &_seq, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+ private:
+    std::atomic<uint32_t>   _seq;
+    std::atomic<int>        _waiters;
+};
+
+/*
+ * Adaptive wait of one thread at one site. Call wait() each time the
+ * condition is found false and done() once the thread made progress.
+ * The first WAIT_SPIN_ROUNDS calls return at once, the next
+ * WAIT_PAUSE_ROUNDS calls pause the core, and later calls park on the
+ * Parking (or just sleep without one) for at most WAIT_PARK_TIMEOUT_US.
+ */
+class Waiter {
+ public:
+    Waiter(WaitSite site, Parking* parking = nullptr)
+        :   _site(site), _parking(parking), _rounds(0), _parks(0), _seq(0), _total_nsec(0)
+    {
+        if (_parking) _seq = _parking->sequence();
+    }
+
+    ~Waiter() {
+        done();
+    }
+
+    void wait() {
+        if (!_rounds++)
+            _start = std::chrono::steady_clock::now();
+
+        if (_rounds <= WAIT_SPIN_ROUNDS) {
+            // retry right away
+
+        } else if (_rounds <= WAIT_SPIN_ROUNDS + WAIT_PAUSE_ROUNDS) {
+            for (int i = 0; i < WAIT_PAUSES_PER_ROUND; i++) {
+                _mm_pause();
+            }
+
+        } else if (_parking) {
+            _parking->park(_seq, WAIT_PARK_TIMEOUT_US);
+            _parks++;
+
+        } else {
+            usleep(WAIT_PARK_TIMEOUT_US);
+            _parks++;
+        }
+
+        if (_parking) _seq = _parking->sequence();
+    }
+
+    void done() {
+        if (!_rounds) return;
+        auto elapsed = std::chrono::steady_clock::now() - _start;
+        uint64_t nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        addStall(_site, nsec, _parks);
+        _total_nsec += nsec;
+        _rounds = 0;
+        _parks = 0;
+    }
+
+    // Time stalled by this waiter so far
+    uint64_t getTotalNsec() const {
+        return _total_nsec;
+    }
+
+ private:
+    WaitSite                _site;
+    Parking*                _parking;
+    uint64_t                _rounds;
+    uint64_t                _parks;
+    uint32_t                _seq;
+    uint64_t                _total_nsec;
+    std::chrono::time_point<std::chrono::steady_clock>  _start;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_WAIT_H
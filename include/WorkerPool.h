@@ -0,0 +1,143 @@
+#ifndef BLAZE_WORKER_POOL_H
+#define BLAZE_WORKER_POOL_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <type_traits>
+#include <immintrin.h>
+#include "galois/Galois.h"
+#include "Wait.h"
+#include "Util.h"
+#include "Param.h"
+
+namespace blaze {
+
+/*
+ * IO and compute workers that live as long as the Runtime. Worker tid
+ * takes the Galois thread id of pool thread tid, so per-thread Galois
+ * structures behave as under ThreadPool::fork(); the pool thread still
+ * runs do_all between rounds, while the worker is parked.
+ *
+ * fork() copies the round's closure into the task slot of each worker
+ * and bumps its epoch; join() waits until the group finished that epoch.
+ * Nothing is allocated per round.
+ */
+class WorkerPool {
+ public:
+    // Workers 1 to num, as far as the machine has threads for them
+    WorkerPool(unsigned num)
+        :   _slots(std::min(num, galois::substrate::getThreadPool().getMaxThreads() - 1) + 1),
+            _group(_slots.size(), 0)
+    {
+        for (unsigned tid = 1; tid < _slots.size(); tid++) {
+            _threads.emplace_back(&WorkerPool::loop, this, tid);
+        }
+    }
+
+    ~WorkerPool() {
+        for (unsigned tid = 1; tid < _slots.size(); tid++) {
+            Slot& slot = _slots[tid];
+            slot.fn = nullptr;
+            slot.epoch.fetch_add(1);
+            slot.start.notify_all();
+        }
+        for (auto& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    // Run task(i) on workers begin + i, 0 <= i < num. The task is copied,
+    // so it may capture locals of the caller by reference.
+    template <typename F>
+    void fork(unsigned begin, unsigned num, const F& task) {
+        static_assert(sizeof(F) <= WORKER_TASK_SIZE, "Task closure too large");
+        static_assert(std::is_trivially_copyable<F>::value, "Task closure must be trivially copyable");
+        BLAZE_ASSERT(begin > 0 && begin + num <= _slots.size(), "Invalid worker range");
+
+        _group[begin] = num;
+        for (unsigned i = 0; i < num; i++) {
+            Slot& slot = _slots[begin + i];
+            memcpy(slot.closure, &task, sizeof(F));
+            slot.fn = &invoke<F>;
+            slot.idx = i;
+            slot.epoch.fetch_add(1);
+            slot.start.notify_all();
+        }
+    }
+
+    // Wait for the workers forked at begin
+    void join(unsigned begin) {
+        for (unsigned tid = begin; tid < begin + _group[begin]; tid++) {
+            Slot& slot = _slots[tid];
+            wait(slot.finish, [&] { return slot.done.load() == slot.epoch.load(); });
+        }
+        _group[begin] = 0;
+    }
+
+ private:
+    using TaskFn = void (*)(const void* closure, int idx);
+
+    struct alignas(CACHE_LINE) Slot {
+        Slot(): epoch(0), done(0), fn(nullptr), idx(0) {}
+
+        std::atomic<uint64_t>   epoch;          // rounds posted
+        std::atomic<uint64_t>   done;           // rounds finished
+        TaskFn                  fn;             // nullptr: exit
+        int                     idx;
+        alignas(16) char        closure[WORKER_TASK_SIZE];
+        Parking                 start;          // worker parks here between rounds
+        Parking                 finish;         // join parks here
+    };
+
+    template <typename F>
+    static void invoke(const void* closure, int idx) {
+        (*(const F*)closure)(idx);
+    }
+
+    // Spin a little, then park; parked threads stay off the CPUs that the
+    // pool threads use for do_all between rounds
+    template <typename Pred>
+    static void wait(Parking& parking, Pred ready) {
+        for (uint64_t rounds = 0; ; rounds++) {
+            uint32_t seq = parking.sequence();
+            if (ready())
+                return;
+            if (rounds < WAIT_SPIN_ROUNDS + WAIT_PAUSE_ROUNDS) {
+                if (rounds >= WAIT_SPIN_ROUNDS) {
+                    for (int i = 0; i < WAIT_PAUSES_PER_ROUND; i++) {
+                        _mm_pause();
+                    }
+                }
+            } else {
+                parking.park(seq, WAIT_PARK_TIMEOUT_US);
+            }
+        }
+    }
+
+    void loop(unsigned tid) {
+        galois::substrate::getThreadPool().adoptTID(tid);
+
+        Slot& slot = _slots[tid];
+        uint64_t seen = 0;
+        while (true) {
+            wait(slot.start, [&] { return slot.epoch.load() != seen; });
+            seen = slot.epoch.load();
+            if (!slot.fn)
+                return;
+            slot.fn(slot.closure, slot.idx);
+            slot.done.store(seen);
+            slot.finish.notify_all();
+        }
+    }
+
+ private:
+    std::vector<Slot>           _slots;     // by tid, 0 unused
+    std::vector<unsigned>       _group;     // size of the group forked at tid
+    std::vector<std::thread>    _threads;
+};
+
+} // namespace blaze
+
+#endif // BLAZE_WORKER_POOL_H
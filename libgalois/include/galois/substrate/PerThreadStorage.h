@@ -91,6 +91,7 @@ extern thread_local char* pssBase;
 PerBackend& getPPSBackend();
 
 void initPTS(unsigned maxT);
+void adoptPTS(unsigned tid);
 
 template <typename T>
 class PerThreadStorage {
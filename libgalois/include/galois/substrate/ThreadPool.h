@@ -166,6 +166,9 @@ public:
   void fork(unsigned begin, std::function<void(void)>& f);
   void fork(unsigned begin, unsigned num, std::vector<std::function<void(void)>>& f);
   void join(unsigned begin);
+  //! make the calling thread, not one of the pool, act as thread tid;
+  //! only while pool thread tid itself is idle
+  void adoptTID(unsigned tid);
 
 
   // experimental: busy wait for work
@@ -169,3 +169,9 @@ void galois::substrate::initPTS(unsigned maxT) {
     pssBase = getPPSBackend().initPerSocket(maxT);
   }
 }
+
+void galois::substrate::adoptPTS(unsigned tid) {
+  // share the storage of an existing thread instead of allocating
+  ptsBase = (char*)getPTSBackend().getRemote(tid, 0);
+  pssBase = (char*)getPPSBackend().getRemote(tid, 0);
+}
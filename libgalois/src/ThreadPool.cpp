@@ -32,6 +32,7 @@ namespace galois {
 namespace substrate {
 
 extern void initPTS(unsigned);
+extern void adoptPTS(unsigned);
 }
 } // namespace galois
 
@@ -273,6 +274,15 @@ void ThreadPool::join(unsigned begin) {
   }
 }
 
+void ThreadPool::adoptTID(unsigned tid) {
+  GALOIS_ASSERT(tid > 0 && tid < mi.maxThreads, "Invalid tid");
+  my_box.topo = signals[tid]->topo;
+  substrate::adoptPTS(tid);
+
+  if (!EnvCheck("GALOIS_DO_NOT_BIND_THREADS"))
+    bindThreadSelf(my_box.topo.osContext);
+}
+
 void ThreadPool::runDedicated(std::function<void(void)>& f) {
   GALOIS_ASSERT(!running,
                 "can't start dedicated thread durring parallel section");
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+#
+# Shared parts of the regression scripts; source it from a test script:
+#
+#   . $(dirname $0)/test_common.sh
+#   setup_work_dir <name> "$@"
+#   ...
+#   finish_test "<pass message>"
+#
+# Test scripts take [bin_dir] [work_dir] as arguments. work_dir must support
+# O_DIRECT (tmpfs does not); it defaults to a new directory under the
+# current one and is removed when the test passes.
+
+failed=0
+
+# sets bin_dir and work_dir and changes into work_dir
+setup_work_dir() {
+    bin_dir=$(realpath ${2:-build/bin})
+    work_dir=${3:-$(mktemp -d -p . $1.XXXXXX)}
+    work_dir=$(realpath ${work_dir})
+    mkdir -p ${work_dir}
+    cd ${work_dir}
+}
+
+# compares two "rank: score vertex" listings printed by the apps; scores
+# are summed in parallel, so they are compared with a tolerance
+compare_scores() {
+    python3 - "$1" "$2" <<'PYEOF'
+import sys
+def load(path):
+    return [(int(l.split()[2]), float(l.split()[1])) for l in open(path)]
+a, b = load(sys.argv[1]), load(sys.argv[2])
+ok = len(a) == len(b) and len(a) > 0
+ok = ok and all(abs(x[1] - y[1]) <= 1e-4 * max(abs(x[1]), 1e-12) for x, y in zip(a, b))
+ok = ok and set(x[0] for x in a) == set(y[0] for y in b)
+sys.exit(0 if ok else 1)
+PYEOF
+}
+
+# reports the result, removes work_dir on success and exits with ${failed}
+finish_test() {
+    if [ ${failed} = 0 ]; then
+        echo "PASS: $1"
+        cd - > /dev/null
+        rm -rf ${work_dir}
+    fi
+    exit ${failed}
+}
@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+#
+# Regression tests for how vertices map to edge blocks: small graphs laid
+# out to hit the corner cases, each checked against what an app reports.
+#
+# usage: test_edge_blocks.sh [bin_dir] [work_dir] (see test_common.sh)
+
+set -e
+. $(dirname $0)/test_common.sh
+
+setup_work_dir edge_blocks "$@"
+opts="-computeWorkers 2 -ioWorkers 1"
+
+# writes graph <name>.gr in the .gr format (version 1, no edge data) from
+# the adjacency lists in the python expression adj of n vertices
+make_graph() {
+    python3 - "$1" "$2" "$3" <<'PYEOF'
+import struct, sys
+name, n = sys.argv[1], int(sys.argv[2])
+adj = eval(sys.argv[3])
+m = sum(len(a) for a in adj)
+with open(name + '.gr', 'wb') as f:
+    f.write(struct.pack('<4Q', 1, 0, n, m))
+    end = 0
+    for a in adj:
+        end += len(a)
+        f.write(struct.pack('<Q', end))
+    for a in adj:
+        f.write(struct.pack('<%dI' % len(a), *a))
+    if m % 2:
+        f.write(b'\0' * 4)
+PYEOF
+    # convert also takes the positional index and adj file arguments of the apps
+    ${bin_dir}/convert ${4} $1.gr $1.gr.index $1.gr.adj > convert.$1.log
+}
+
+# prints the "<nodes> <edges> <bytes>" of round $2 in the log $1
+edge_map_round() {
+    grep -E "^# EDGEMAP +$2 :" $1 | sed -E 's/[^0-9]+[0-9]+[^0-9]+([0-9]+)[^0-9]+([0-9]+)[^0-9]+([0-9]+).*/\1 \2 \3/'
+}
+
+# activate_all sets every bit of the frontier; bits past the last vertex
+# would add the degrees of vertices that do not exist, here read from the
+# byte index that follows the degrees of a compressed graph
+make_graph ring 100 "[[(v + 1) % n] for v in range(n)]" -compress
+${bin_dir}/pagerank ${opts} -maxIterations 1 ring.gr.index ring.gr.adj.1.0 > ring.log
+round=$(edge_map_round ring.log 1)
+if [ "${round% *}" != "100 100" ]; then
+    echo "FAIL: activate_all on 100 vertices: ${round% *} nodes and edges"
+    failed=1
+fi
+
+# the 1024 edges of vertex 0 fill the first 4 kB block exactly, so the
+# first bfs round reads that block alone and not the one after it
+make_graph boundary 3000 "[list(range(1, 1025)), [2, 3]] + [[]] * (n - 2)"
+${bin_dir}/bfs ${opts} -inlinePages 0 -startNode 0 \
+    boundary.gr.index boundary.gr.adj.1.0 > boundary.log
+round=$(edge_map_round boundary.log 1)
+if [ "${round#* * }" != 4096 ]; then
+    echo "FAIL: edges ending on a block boundary: ${round#* * } bytes read"
+    failed=1
+fi
+
+# only the last vertex has edges, to every other one, over three blocks;
+# no vertex follows it to map its last block, which bfs must still scan
+make_graph last 3000 "[[]] * (n - 1) + [list(range(n - 1))]"
+${bin_dir}/bfs ${opts} -inlinePages 0 -startNode 2999 \
+    last.gr.index last.gr.adj.1.0 > last.log
+if ! grep -q "^Reached: 3000," last.log; then
+    echo "FAIL: last vertex over several blocks: $(grep ^Reached: last.log)"
+    failed=1
+fi
+
+finish_test "edge blocks of boundary vertices"
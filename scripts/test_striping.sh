@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+#
+# Regression test for striped edge files: converts a small random graph
+# for 1, 3 and 6 disks, runs bfs and pagerank on each and compares the
+# results against the single-disk run.
+#
+# usage: test_striping.sh [bin_dir] [work_dir] (see test_common.sh)
+
+set -e
+. $(dirname $0)/test_common.sh
+
+setup_work_dir striping "$@"
+threads=2
+cpus=$(grep -c ^processor /proc/cpuinfo)
+disks="1 3 6"
+
+# random directed graph in the .gr format (version 1, no edge data)
+python3 - <<'EOF'
+import random, struct
+random.seed(1)
+n, m = 20000, 300000
+adj = [[] for _ in range(n)]
+for _ in range(m):
+    adj[random.randrange(n)].append(random.randrange(n))
+with open('graph.gr', 'wb') as f:
+    f.write(struct.pack('<4Q', 1, 0, n, m))
+    end = 0
+    for a in adj:
+        end += len(a)
+        f.write(struct.pack('<Q', end))
+    for a in adj:
+        f.write(struct.pack('<%dI' % len(a), *sorted(a)))
+    if m % 2:
+        f.write(b'\0' * 4)
+EOF
+
+for d in ${disks}; do
+    mkdir -p disk${d}
+    ln -sf ../graph.gr disk${d}/graph.gr
+    # convert also takes the positional index and adj file arguments of the apps
+    ${bin_dir}/convert -numDisks ${d} disk${d}/graph.gr \
+        disk${d}/graph.gr.index disk${d}/graph.gr.adj > disk${d}/convert.log
+    adj_files=$(ls disk${d}/graph.gr.adj.${d}.* | sort -t. -k5 -n)
+
+    # one IO worker per file, as far as the machine has threads for them
+    io_workers=$(( d < cpus - threads - 1 ? d : cpus - threads - 1 ))
+    [ ${io_workers} -lt 1 ] && io_workers=1
+    opts="-computeWorkers ${threads} -ioWorkers ${io_workers}"
+
+    ${bin_dir}/bfs ${opts} -startNode 0 \
+        disk${d}/graph.gr.index ${adj_files} > disk${d}/bfs.log
+    # the level checksum covers every vertex, not just how many were reached
+    grep -E "^(Reached|Level checksum):" disk${d}/bfs.log > disk${d}/bfs.out
+
+    ${bin_dir}/pagerank ${opts} -maxIterations 10 \
+        disk${d}/graph.gr.index ${adj_files} > disk${d}/pagerank.log
+    grep -E "^ *[0-9]+: " disk${d}/pagerank.log > disk${d}/pagerank.out
+done
+
+for d in ${disks}; do
+    [ ${d} = 1 ] && continue
+    if ! diff -q disk1/bfs.out disk${d}/bfs.out > /dev/null; then
+        echo "FAIL: bfs on ${d} disks"; diff disk1/bfs.out disk${d}/bfs.out || true
+        failed=1
+    fi
+    if ! compare_scores disk1/pagerank.out disk${d}/pagerank.out; then
+        echo "FAIL: pagerank on ${d} disks"; diff disk1/pagerank.out disk${d}/pagerank.out || true
+        failed=1
+    fi
+done
+
+finish_test "bfs and pagerank match on ${disks// /, } disks"